@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+#include "triegraph/util/memory.h"
+#include "triegraph/util/timer.h"
+
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+
+using namespace triegraph;
+
+/**
+ * Runs every builder on the same graph and KmerSettings. Besides the usual
+ * test output (on stderr), prints a tab separated row per run on stdout:
+ *
+ * builder graph td_rel trie_depth pairs unique dup_ratio build_ms sort_ms
+ * pairs_per_sec peak_rss_kb
+ *
+ * peak_rss_kb is the peak resident memory the builder run added on top of
+ * what was resident before it (VmHWM is reset right before the run, so
+ * graph loading doesn't mask it). Benchmarks are run in a separate process,
+ * so runs don't affect each other.
+ */
+template <typename TG, typename TrieBuilder>
+struct BuilderTester : public test::TestCaseBase {
+    std::string builder, graph_name, graph_file;
+    int td_rel;
+
+    std::unique_ptr<typename TG::Graph> graph;
+    typename TG::LetterLocData lloc;
+    KmerSettings ks;
+
+    BuilderTester(const std::string &builder, const std::string &graph_name,
+            const std::string &graph_file, int td_rel)
+        : TestCaseBase(builder + "::" + graph_name + "::+" + std::to_string(td_rel)),
+          builder(builder),
+          graph_name(graph_name),
+          graph_file(graph_file),
+          td_rel(td_rel)
+    {}
+
+    virtual void prepare() {
+        graph = std::make_unique<typename TG::Graph>(
+                TG::Graph::from_file(graph_file, {}));
+        lloc = typename TG::LetterLocData(*graph);
+        ks = KmerSettings::from_seed_config<typename TG::KmerHolder>(
+                lloc.num_locations, MapCfg {
+                    "trie-depth-rel", std::to_string(td_rel)});
+    }
+
+    virtual void run() {
+        using Timer = triegraph::Timer<>;
+
+        Memory::reset_peak();
+        auto start_mem = Memory::current();
+        auto start_time = Timer::now();
+        auto pairs = TG::template graph_to_pairs<TrieBuilder>(
+                *graph, lloc, ks, {}, lloc);
+        auto build_ms = start_time.elapsed();
+        auto peak = Memory::current().vmhwm - start_mem.vmrss;
+
+        u64 total = pairs.size();
+        auto sort_start = Timer::now();
+        pairs.sort_by_fwd().unique();
+        auto sort_ms = sort_start.elapsed();
+        u64 unique = pairs.size();
+
+        std::ostringstream os;
+        os << builder
+            << '\t' << graph_name
+            << '\t' << td_rel
+            << '\t' << ks.trie_depth
+            << '\t' << total
+            << '\t' << unique
+            << '\t' << (total ? double(total - unique) / total : 0.0)
+            << '\t' << build_ms
+            << '\t' << sort_ms
+            << '\t' << u64(total * 1000.0 / std::max<decltype(build_ms)>(build_ms, 1))
+            << '\t' << peak
+            << '\n';
+        std::cout << os.str() << std::flush;
+    }
+};
+
+static void print_header() {
+    std::cout << "builder\tgraph\ttd_rel\ttrie_depth\tpairs\tunique\t"
+        "dup_ratio\tbuild_ms\tsort_ms\tpairs_per_sec\tpeak_rss_kb\n"
+        << std::flush;
+}
+
+template <typename TG>
+static void define_tests() {
+    std::vector<std::pair<std::string, std::string>> graphs = {
+        { "pasgal", "data/pasgal-MHC1.gfa" },
+        // { "hg22", "data/hg_22_nn.gfa" },
+        // { "hg22_linear", "data/HG_22_linear.gfa" },
+    };
+    print_header();
+    for (const auto &[name, file] : graphs) {
+        for (int td_rel = 0; td_rel <= 2; ++td_rel) {
+            test::add_test<BuilderTester<TG, typename TG::TrieBuilderLBFS>>(
+                    "lbfs", name, file, td_rel);
+            test::add_test<BuilderTester<TG, typename TG::TrieBuilderLBFSPar>>(
+                    "lbfs_par", name, file, td_rel);
+            test::add_test<BuilderTester<TG, typename TG::TrieBuilderBT>>(
+                    "bt", name, file, td_rel);
+            test::add_test<BuilderTester<TG, typename TG::TrieBuilderPBFS>>(
+                    "pbfs", name, file, td_rel);
+            test::add_test<BuilderTester<TG, typename TG::TrieBuilderNBFS>>(
+                    "nbfs", name, file, td_rel);
+            test::add_test<BuilderTester<TG, typename TG::TrieBuilderNBFSPar>>(
+                    "nbfs_par", name, file, td_rel);
+        }
+    }
+}
+
+using TG = Manager<dna::DnaConfig<0>>;
+
+int m = test::define_module(__FILE__, [] {
+    define_tests<TG>();
+});
@@ -44,6 +44,16 @@ static TG::VectorPairs graph_to_pairs(
                     graph, lloc, std::move(kmer_settings),
                     TG::TrieBuilderNBFS::Settings::from_config(cfg),
                     lloc);
+        case TG::Algo::NODE_BFS_PAR:
+            return TG::template graph_to_pairs<typename TG::TrieBuilderNBFSPar>(
+                    graph, lloc, std::move(kmer_settings),
+                    TG::TrieBuilderNBFSPar::Settings::from_config(cfg),
+                    lloc);
+        case TG::Algo::LOCATION_BFS_PAR:
+            return TG::template graph_to_pairs<typename TG::TrieBuilderLBFSPar>(
+                    graph, lloc, std::move(kmer_settings),
+                    TG::TrieBuilderLBFSPar::Settings::from_config(cfg),
+                    lloc);
         default:
             throw "Unknown algorithm";
     }
@@ -75,6 +75,16 @@ struct TrieDataBuilderTester : test::TestCaseBase {
                         graph, lloc, std::move(kmer_settings),
                         TG::TrieBuilderNBFS::Settings::from_config(cfg),
                         lloc);
+            case TG::Algo::NODE_BFS_PAR:
+                return TG::graph_to_pairs<TG::TrieBuilderNBFSPar>(
+                        graph, lloc, std::move(kmer_settings),
+                        TG::TrieBuilderNBFSPar::Settings::from_config(cfg),
+                        lloc);
+            case TG::Algo::LOCATION_BFS_PAR:
+                return TG::graph_to_pairs<TG::TrieBuilderLBFSPar>(
+                        graph, lloc, std::move(kmer_settings),
+                        TG::TrieBuilderLBFSPar::Settings::from_config(cfg),
+                        lloc);
             default:
                 throw "Unknown algorithm";
         }
@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TESTLIB_TMP_FILE_H__
+#define __TESTLIB_TMP_FILE_H__
+
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+namespace test {
+
+// per-process path in the temp dir, so parallel test runs don't collide
+static std::string tmp_file(const std::string &name) {
+    return std::filesystem::temp_directory_path() /
+        ("triegraph-test-" + name + "-" + std::to_string(::getpid()));
+}
+
+} /* namespace test */
+
+#endif /* __TESTLIB_TMP_FILE_H__ */
@@ -0,0 +1,47 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TESTLIB_TRIE_TRIE_DATA_H__
+#define __TESTLIB_TRIE_TRIE_DATA_H__
+
+#include "triegraph/util/util.h"
+#include "triegraph/trie/kmer_settings.h"
+
+#include "testlib/test.h"
+
+#include <algorithm>
+
+namespace test {
+
+// TrieData of all kmers in g (by NBFS)
+template <typename TG>
+static TG::TrieData td_from_graph(const typename TG::Graph &g,
+        const typename TG::LetterLocData &lloc, triegraph::u16 trie_depth = 4) {
+    auto ks = TG::KmerSettings::template from_depth<typename TG::KmerHolder>(trie_depth);
+    auto pairs = TG::template graph_to_pairs<typename TG::TrieBuilderNBFS>(
+            g, lloc, ks, {}, lloc);
+    return TG::pairs_to_triedata(std::move(pairs), lloc);
+}
+
+// same kmers at the same locations (g2t values in any order), and the same
+// active trie
+template <typename TG>
+static bool td_equal(const typename TG::TrieData &a, const typename TG::TrieData &b,
+        const typename TG::LetterLocData &lloc) {
+    for (typename TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+        if (!equal_sorted(a.graph2trie.values_for(loc),
+                    sorted(b.graph2trie.values_for(loc))))
+            return false;
+    if (!std::ranges::equal(a.trie2graph.keys(), b.trie2graph.keys()))
+        return false;
+    for (auto kh : a.trie2graph.keys())
+        if (!std::ranges::equal(a.trie2graph.values_for(kh), b.trie2graph.values_for(kh)))
+            return false;
+    return a.active_trie.present == b.active_trie.present;
+}
+
+} /* namespace test */
+
+#endif /* __TESTLIB_TRIE_TRIE_DATA_H__ */
@@ -91,6 +91,10 @@ test::define_test("simple dag2", [] {
                 std::vector<TG::KmerHolder> { 1, 1, 2, 2, 4, 4, 8 }));
     assert(std::ranges::equal(ce.get_ends(),
                 std::vector<TG::KmerHolder> { 1, 1, 2, 2, 4, 4, 8 }));
+    assert(std::ranges::equal(ce.get_depths(2, 2),
+                std::vector<triegraph::u32> { 4, 4, 4, 4, 3, 3, 3 }));
+    assert(std::ranges::equal(ce.get_depths(1, 2),
+                std::vector<triegraph::u32> { 4, 4, 3, 3, 3, 3, 2 }));
 });
 
 test::define_test("simple loop", [] {
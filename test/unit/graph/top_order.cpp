@@ -90,4 +90,37 @@ test::define_test("simple cyclic 2", [] {
     assert(top_ord.idx[3] == 3);
 });
 
+test::define_test("queue matches heap queue", [] {
+    auto builder = TG::Graph::Builder({
+            .add_reverse_complement = false, .add_extends = false });
+    constexpr int N = 200;
+    for (int i = 0; i < N; ++i)
+        builder.add_node(TG::Str("a"), "s" + std::to_string(i));
+    for (int i = 0; i + 1 < N; ++i)
+        builder.add_edge("s" + std::to_string(i), "s" + std::to_string(i + 1));
+    for (int i = 0; i + 7 < N; i += 3)
+        builder.add_edge("s" + std::to_string(i), "s" + std::to_string(i + 7));
+    auto graph = builder.build();
+
+    using TopOrder = triegraph::TopOrder<TG::Graph>;
+    auto top_ord = TopOrder::Builder(graph).build();
+    TopOrder::Queue q(top_ord);
+    TopOrder::HeapQueue hq(top_ord);
+
+    // pops in order, pushes mostly forward, sometimes back
+    triegraph::u32 seed = 17;
+    auto rnd = [&seed]() { return seed = seed * 1103515245u + 12345u; };
+    q.push(0); hq.push(0);
+    for (int step = 0; step < 5000 && !hq.empty(); ++step) {
+        assert(!q.empty());
+        auto a = q.pop(), b = hq.pop();
+        assert(a == b);
+        for (int k = 0; k < 2; ++k) {
+            auto r = rnd() >> 8;
+            TG::NodeLoc to = (r % 10 == 0) ? (r / 10) % N : std::min<int>(N - 1, a + 1 + r % 5);
+            q.push(to); hq.push(to);
+        }
+    }
+});
+
 });
@@ -0,0 +1,92 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/trie/builder/kmer_build_data.h"
+
+#include "testlib/dna.h"
+#include "testlib/test.h"
+
+#include <algorithm>
+
+using TG = test::Manager_RK;
+using KmerBuildData = triegraph::KmerBuildData<TG::Kmer, triegraph::u32>;
+using triegraph::u32;
+
+static TG::Kmer kmer_at(u32 i) {
+    return TG::Kmer::from_compressed_leaf(i & (TG::Kmer::NUM_LEAFS - 1));
+}
+
+int m = test::define_module(__FILE__, [] {
+    TG::Kmer::set_settings(triegraph::KmerSettings::from_depth<TG::KmerHolder>(12));
+
+    test::define_test("add exists get", [] {
+        auto kd = KmerBuildData(10);
+        assert(kd.num_kmers(3) == 0);
+        assert(!kd.exists(3, kmer_at(1)));
+
+        for (u32 i = 0; i < 7; ++i)
+            assert(kd.add_kmer(3, kmer_at(i)) == i + 1);
+        kd.add_kmer(4, kmer_at(100));
+
+        assert(kd.num_kmers(3) == 7);
+        assert(kd.num_kmers(4) == 1);
+        for (u32 i = 0; i < 7; ++i) {
+            assert(kd.exists(3, kmer_at(i)));
+            assert(kd.get(3, i) == kmer_at(i));
+        }
+        assert(!kd.exists(3, kmer_at(100)));
+        assert(kd.exists(4, kmer_at(100)));
+        assert(kd.kmers(3).size() == 7);
+        assert(std::ranges::equal(kd.kmers(4), std::vector { kmer_at(100) }));
+    });
+
+    test::define_test("done idx", [] {
+        auto kd = KmerBuildData(2);
+        kd.add_kmer(1, kmer_at(5));
+        assert(kd.done_idx(1) == 0);
+        ++kd.done_idx(1);
+        assert(kd.done_idx(1) == 1);
+        assert(kd.done_idx(0) == 0);
+    });
+
+    test::define_test("set above cutoff", [] {
+        auto kd = KmerBuildData(3, 4);
+        for (u32 i = 0; i < 1000; ++i)
+            kd.add_kmer(1, kmer_at(i * 7));
+        assert(kd.num_sets() == 1);
+        for (u32 i = 0; i < 1000; ++i) {
+            assert(kd.exists(1, kmer_at(i * 7)));
+            assert(kd.get(1, i) == kmer_at(i * 7));
+        }
+        assert(!kd.exists(1, kmer_at(1)));
+        assert(!kd.exists(2, kmer_at(0)));
+    });
+
+    test::define_test("big lists", [] {
+        auto kd = KmerBuildData(2);
+        for (u32 i = 0; i < 100000; ++i)
+            kd.add_kmer(i % 2, kmer_at(i));
+        for (u32 i = 0; i < 100000; ++i)
+            assert(kd.get(i % 2, i / 2) == kmer_at(i));
+    });
+
+    test::define_test("release", [] {
+        auto kd = KmerBuildData(3, 4);
+        for (u32 i = 0; i < 10; ++i)
+            kd.add_kmer(0, kmer_at(i));
+        ++kd.done_idx(0);
+        kd.release(0);
+        assert(kd.num_kmers(0) == 0);
+        assert(kd.done_idx(0) == 0);
+        assert(kd.num_sets() == 0);
+        assert(!kd.exists(0, kmer_at(1)));
+
+        // memory gets reused
+        for (u32 i = 0; i < 10; ++i)
+            kd.add_kmer(1, kmer_at(i + 20));
+        for (u32 i = 0; i < 10; ++i)
+            assert(kd.get(1, i) == kmer_at(i + 20));
+    });
+});
@@ -8,5 +8,35 @@
 #include "testlib/trie/builder/tester.h"
 
 using TG = test::Manager_RK;
-int m = test::define_module(__FILE__,
-    &test::TrieBuilderTester<TG, TG::TrieBuilderLBFS>::define_tests);
+
+int m = test::define_module(__FILE__, [] {
+    using Tester = test::TrieBuilderTester<TG, TG::TrieBuilderLBFS>;
+    Tester::define_tests();
+
+    test::define_test("streaming matches default", [] {
+        auto graph = TG::Graph::Builder({ .add_reverse_complement = false })
+            .add_node(TG::Str("acgt"), "s1")
+            .add_node(TG::Str("a"), "s2")
+            .add_node(TG::Str("cc"), "s3")
+            .add_node(TG::Str("gtac"), "s4")
+            .add_node(TG::Str("t"), "s5")
+            .add_node(TG::Str("gga"), "s6")
+            .add_edge("s1", "s2")
+            .add_edge("s1", "s3")
+            .add_edge("s2", "s4")
+            .add_edge("s3", "s4")
+            .add_edge("s4", "s5")
+            .add_edge("s5", "s4") // cycle
+            .add_edge("s4", "s6")
+            .build();
+
+        for (auto td : { 3, 4, 6 }) {
+            auto expected = Tester::graph_to_pairs(graph, {}, td);
+            auto actual = Tester::graph_to_pairs(graph, { .streaming = true }, td);
+
+            assert(std::ranges::equal(
+                        actual.sort_by_fwd().unique().fwd_pairs(),
+                        expected.sort_by_fwd().unique().fwd_pairs()));
+        }
+    });
+});
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/dna.h"
+#include "testlib/test.h"
+#include "testlib/trie/builder/tester.h"
+
+#include <string>
+
+using TG = test::Manager_RK;
+
+int m = test::define_module(__FILE__, [] {
+    using Tester = test::TrieBuilderTester<TG, TG::TrieBuilderLBFSPar>;
+    Tester::define_tests();
+
+    test::define_test("matches lbfs", [] {
+        // a chain of wide bubbles with a cycle over some of them
+        auto builder = TG::Graph::Builder({ .add_reverse_complement = false });
+        const char *segs[] = { "acg", "t", "ga", "cat", "g", "tc", "aag" };
+        auto bubble = [](int i, int j) {
+            return "b" + std::to_string(i) + "_" + std::to_string(j);
+        };
+        auto join = [](int i) { return "j" + std::to_string(i); };
+        builder.add_node(TG::Str("gattaca"), "src");
+        for (int i = 0; i < 6; ++i) {
+            for (int j = 0; j < 7; ++j)
+                builder.add_node(TG::Str(segs[(i * 3 + j) % 7]), bubble(i, j));
+            builder.add_node(TG::Str("ct"), join(i));
+        }
+        for (int i = 0; i < 6; ++i) {
+            for (int j = 0; j < 7; ++j) {
+                builder.add_edge(i ? join(i - 1) : "src", bubble(i, j));
+                builder.add_edge(bubble(i, j), join(i));
+            }
+        }
+        builder.add_edge("j4", "j1");
+        auto graph = builder.build();
+
+        auto expected = test::TrieBuilderTester<TG, TG::TrieBuilderLBFS>
+            ::graph_to_pairs(graph, {}, 6);
+        auto actual = Tester::graph_to_pairs(graph, {
+                .num_threads = 4,
+                .min_parallel_frontier = 1 }, 6);
+
+        assert(std::ranges::equal(
+                    actual.sort_by_fwd().unique().fwd_pairs(),
+                    expected.sort_by_fwd().unique().fwd_pairs()));
+    });
+});
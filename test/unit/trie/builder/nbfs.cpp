@@ -7,6 +7,8 @@
 #include "testlib/test.h"
 #include "testlib/trie/builder/tester.h"
 
+#include <string>
+
 using TG = test::Manager_RK;
 
 int m = test::define_module(__FILE__, [] {
@@ -102,4 +104,162 @@ int m = test::define_module(__FILE__, [] {
         }));
     });
 
+    test::define_test("heap queue", [] {
+        auto graph = TG::Graph::Builder({
+                .add_reverse_complement = false })
+            .add_node(TG::Str("acg"), "s1")
+            .add_node(TG::Str("t"), "s2")
+            .add_node(TG::Str("ga"), "s3")
+            .add_node(TG::Str("cct"), "s4")
+            .add_edge("s1", "s2")
+            .add_edge("s1", "s3")
+            .add_edge("s2", "s3")
+            .add_edge("s3", "s2") // cycle
+            .add_edge("s3", "s4")
+            .build();
+
+        auto expected = Tester::graph_to_pairs(graph, { .heap_queue = true }, 5);
+        auto actual = Tester::graph_to_pairs(graph, {}, 5);
+
+        assert(std::ranges::equal(
+                    actual.sort_by_fwd().unique().fwd_pairs(),
+                    expected.sort_by_fwd().unique().fwd_pairs()));
+    });
+
+    test::define_test("sorted output", [] {
+        auto graph = TG::Graph::Builder({
+                .add_reverse_complement = false })
+            .add_node(TG::Str("acgtt"), "s1")
+            .add_node(TG::Str("t"), "s2")
+            .add_node(TG::Str("ga"), "s3")
+            .add_node(TG::Str("cctag"), "s4")
+            .add_edge("s1", "s2")
+            .add_edge("s1", "s3")
+            .add_edge("s2", "s3")
+            .add_edge("s3", "s2") // cycle
+            .add_edge("s3", "s4")
+            .build();
+
+        auto expected = Tester::graph_to_pairs(graph, {}, 4);
+        auto actual = Tester::graph_to_pairs(graph, { .sorted_output = true }, 4);
+
+        assert(actual.get_order() == triegraph::VectorPairsOrder::REV);
+        auto rev = actual.rev_pairs();
+        assert(std::ranges::is_sorted(rev));
+        assert(std::ranges::adjacent_find(rev) == rev.end());
+        assert(std::ranges::equal(
+                    actual.sort_by_rev().unique().fwd_pairs(),
+                    expected.sort_by_rev().unique().fwd_pairs()));
+
+        // appended after other pairs, they are not sorted as a whole
+        auto lloc = TG::LetterLocData(graph);
+        auto more = TG::VectorPairs {};
+        more.emplace_back(TG::Kmer::from_str("tttt"), 100);
+        triegraph::TrieBuilderNBFS<TG::Graph, TG::LetterLocData, TG::Kmer, TG::VectorPairs>(
+                graph, lloc, more)
+            .set_settings({ .sorted_output = true })
+            .compute_pairs(lloc);
+        assert(more.size() == actual.size() + 1);
+        assert(more.get_order() == triegraph::VectorPairsOrder::NONE);
+    });
+
+
+    test::define_test("pairs generator", [] {
+        auto graph = TG::Graph::Builder({
+                .add_reverse_complement = false })
+            .add_node(TG::Str("acgt"), "s1")
+            .add_node(TG::Str("ga"), "s2")
+            .add_node(TG::Str("t"), "s3")
+            .add_node(TG::Str("cca"), "s4")
+            .add_edge("s1", "s2")
+            .add_edge("s1", "s3")
+            .add_edge("s2", "s4")
+            .add_edge("s3", "s4")
+            .build();
+        auto expected = Tester::graph_to_pairs(graph, {}, 3);
+
+        auto lloc = TG::LetterLocData(graph);
+        auto ks = TG::KmerSettings::from_depth<TG::KmerHolder>(3);
+        auto actual = TG::VectorPairs {};
+        for (const auto &[kmer, loc] : TG::pairs_generator<TG::TrieBuilderNBFS>(
+                    graph, lloc, ks, {}, lloc))
+            actual.emplace_back(kmer, loc);
+
+        assert(actual.size() == expected.size());
+        assert(std::ranges::equal(
+                    actual.sort_by_fwd().unique().fwd_pairs(),
+                    expected.sort_by_fwd().unique().fwd_pairs()));
+    });
+
+    test::define_test("pairs generator, consumer logs", [] {
+        // the producer logs too, on its own (muted) logger; more pairs than
+        // a block, so the producer is still running while the consumer logs
+        std::string seq;
+        for (triegraph::u32 i = 0, x = 1; i < 100000; ++i, x = x * 1103515245 + 12345)
+            seq.push_back("acgt"[x >> 16 & 3]);
+        auto graph = TG::Graph::Builder({
+                .add_reverse_complement = false })
+            .add_node(TG::Str(seq), "s1")
+            .add_node(TG::Str("ggattca"), "s2")
+            .add_node(TG::Str("tttcagtcaggcatg"), "s3")
+            .add_edge("s1", "s2")
+            .add_edge("s1", "s3")
+            .add_edge("s2", "s3")
+            .build();
+        auto expected = Tester::graph_to_pairs(graph, {}, 4);
+
+        auto lloc = TG::LetterLocData(graph);
+        auto ks = TG::KmerSettings::from_depth<TG::KmerHolder>(4);
+        auto actual = TG::VectorPairs {};
+        auto &log = triegraph::Logger::get();
+        {
+            auto scope = log.begin_scoped("consumer");
+            for (const auto &[kmer, loc] : TG::pairs_generator<TG::TrieBuilderNBFS>(
+                        graph, lloc, ks, {}, lloc)) {
+                auto pair_scope = log.begin_scoped("pair");
+                log.log("loc", loc);
+                actual.emplace_back(kmer, loc);
+            }
+        }
+        // the shared logger is still usable (its timers weren't popped)
+        log.begin("after").end();
+
+        assert(actual.size() == expected.size());
+        assert(std::ranges::equal(
+                    actual.sort_by_fwd().unique().fwd_pairs(),
+                    expected.sort_by_fwd().unique().fwd_pairs()));
+    });
+
+    test::define_test("dedup", [] {
+        // bubbles and a cycle, so walks meet
+        auto graph = TG::Graph::Builder({ .add_reverse_complement = false })
+            .add_node(TG::Str("acg"), "s1")
+            .add_node(TG::Str("t"), "s2")
+            .add_node(TG::Str("c"), "s3")
+            .add_node(TG::Str("gat"), "s4")
+            .add_node(TG::Str("a"), "s5")
+            .add_node(TG::Str("g"), "s6")
+            .add_node(TG::Str("ctt"), "s7")
+            .add_edge("s1", "s2")
+            .add_edge("s1", "s3")
+            .add_edge("s2", "s4")
+            .add_edge("s3", "s4")
+            .add_edge("s4", "s5")
+            .add_edge("s4", "s6")
+            .add_edge("s5", "s7")
+            .add_edge("s6", "s7")
+            .add_edge("s7", "s1")
+            .build();
+        auto all = Tester::graph_to_pairs(graph, {}, 6);
+
+        auto saved = triegraph::DedupPairsSettings::default_settings();
+        triegraph::DedupPairsSettings::default_settings() = { .bits = 10 };
+        auto dedup = Tester::graph_to_pairs(graph, {}, 6);
+        triegraph::DedupPairsSettings::default_settings() = saved;
+
+        assert(dedup.size() < all.size());
+        assert(std::ranges::equal(
+                    dedup.sort_by_fwd().unique().fwd_pairs(),
+                    all.sort_by_fwd().unique().fwd_pairs()));
+    });
 });
@@ -0,0 +1,108 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/dna.h"
+#include "testlib/test.h"
+#include "testlib/trie/builder/tester.h"
+
+#include <string>
+
+using TG = test::Manager_RK;
+
+// many parallel bubbles, so levels have more than one node, and a back-edge,
+// so more than one sweep is needed
+template <typename TG>
+static TG::Graph wide_graph() {
+    auto builder = typename TG::Graph::Builder({ .add_reverse_complement = false });
+    const char *segs[] = { "a", "cg", "t", "gca", "c", "ta" };
+    auto bubble = [](int i, int j) {
+        return "b" + std::to_string(i) + "_" + std::to_string(j);
+    };
+    auto join = [](int i) { return "j" + std::to_string(i); };
+    builder.add_node(typename TG::Str("ac"), "src");
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 6; ++j)
+            builder.add_node(typename TG::Str(segs[(i + j) % 6]), bubble(i, j));
+        builder.add_node(typename TG::Str("g"), join(i));
+    }
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 6; ++j) {
+            builder.add_edge(i ? join(i - 1) : "src", bubble(i, j));
+            builder.add_edge(bubble(i, j), join(i));
+        }
+    }
+    builder.add_edge("j5", "j2");
+    return builder.build();
+}
+
+// Dual pairs, filled from all threads (through a ConcurrentPairsSink for
+// VmVector pairs)
+template <typename TG>
+static void matches_nbfs_dual() {
+    auto graph = wide_graph<TG>();
+    auto expected = test::TrieBuilderTester<TG, typename TG::TrieBuilderNBFS>
+        ::graph_to_pairs(graph, {}, 6);
+    auto actual = test::TrieBuilderTester<TG, typename TG::TrieBuilderNBFSPar>
+        ::graph_to_pairs(graph, {
+                .num_threads = 4,
+                .min_parallel_level = 1 }, 6);
+
+    assert(actual.size() == expected.size());
+    assert(std::ranges::equal(
+                actual.sort_by_fwd().unique().fwd_pairs(),
+                expected.sort_by_fwd().unique().fwd_pairs()));
+}
+
+int m = test::define_module(__FILE__, [] {
+    using Tester = test::TrieBuilderTester<TG, TG::TrieBuilderNBFSPar>;
+    Tester::define_tests();
+
+    test::define_test("matches nbfs", [&] {
+        auto graph = wide_graph<TG>();
+        auto expected = test::TrieBuilderTester<TG, TG::TrieBuilderNBFS>
+            ::graph_to_pairs(graph, {}, 6);
+        auto actual = Tester::graph_to_pairs(graph, {
+                .num_threads = 4,
+                .min_parallel_level = 1 }, 6);
+
+        assert(std::ranges::equal(
+                    actual.sort_by_fwd().unique().fwd_pairs(),
+                    expected.sort_by_fwd().unique().fwd_pairs()));
+    });
+
+    test::define_test("single thread", [&] {
+        auto graph = wide_graph<TG>();
+        auto expected = test::TrieBuilderTester<TG, TG::TrieBuilderNBFS>
+            ::graph_to_pairs(graph, {}, 4);
+        auto actual = Tester::graph_to_pairs(graph, {
+                .num_threads = 1 }, 4);
+
+        assert(std::ranges::equal(
+                    actual.sort_by_fwd().unique().fwd_pairs(),
+                    expected.sort_by_fwd().unique().fwd_pairs()));
+    });
+
+    using triegraph::dna::CfgFlags;
+    using triegraph::dna::DnaConfig;
+    test::define_test("dual pairs", [] {
+        matches_nbfs_dual<triegraph::Manager<DnaConfig<0>>>();
+    });
+    test::define_test("dual compact pairs", [] {
+        matches_nbfs_dual<triegraph::Manager<DnaConfig<0,
+            CfgFlags::VP_DUAL_IMPL | CfgFlags::CV_ELEMS>>>();
+    });
+    test::define_test("sink only for vm pairs", [] {
+        using TGV = triegraph::Manager<DnaConfig<0,
+            CfgFlags::VP_DUAL_IMPL | CfgFlags::VP_VM_VECTOR>>;
+        using TGC = triegraph::Manager<DnaConfig<0,
+            CfgFlags::VP_DUAL_IMPL | CfgFlags::CV_ELEMS>>;
+        static_assert(triegraph::concurrent_pairs_sink_v<TGV::VPAlgoPar>);
+        static_assert(!triegraph::concurrent_pairs_sink_v<TGC::VPAlgoPar>);
+    });
+    test::define_test("dual vm pairs", [] {
+        matches_nbfs_dual<triegraph::Manager<DnaConfig<0,
+            CfgFlags::VP_DUAL_IMPL | CfgFlags::CV_ELEMS | CfgFlags::VP_VM_VECTOR>>>();
+    });
+});
@@ -73,4 +73,57 @@ int m = test::define_module(__FILE__, [] {
         }));
 
     });
+
+    test::define_test("region depth", [] {
+        auto kmer_s = &TGX::Kmer::from_str;
+        auto graph = TGX::Graph::Builder({ .add_reverse_complement = false })
+            .add_node(TGX::Str("acgtac"), "s0")
+            .add_node(TGX::Str("a"), "s10")
+            .add_node(TGX::Str("g"), "s11")
+            .add_node(TGX::Str("c"), "s20")
+            .add_node(TGX::Str("t"), "s21")
+            .add_node(TGX::Str("ttgcatt"), "s3")
+            .add_edge("s0", "s10")
+            .add_edge("s0", "s11")
+            .add_edge("s10", "s20")
+            .add_edge("s10", "s21")
+            .add_edge("s11", "s20")
+            .add_edge("s11", "s21")
+            .add_edge("s20", "s3")
+            .add_edge("s21", "s3")
+            .build();
+
+        auto pairs = test::TrieBuilderTester<TGX, TGX::TrieBuilderPBFS>::graph_to_pairs(
+                graph, { .region_max_kmers = 1, .region_min_depth = 2 }, 4);
+        // s2x and s3 get depth 3, kmers crossing into them stop at 3 letters
+        assert(std::ranges::equal(pairs.sort_by_fwd().unique().fwd_pairs(),
+                    typename decltype(pairs)::fwd_vec {
+            { kmer_s("aca"), 8 },
+            { kmer_s("aca"), 9 },
+            { kmer_s("acg"), 8 },
+            { kmer_s("acg"), 9 },
+            { kmer_s("act"), 11 },
+            { kmer_s("att"), 11 },
+            { kmer_s("cac"), 10 },
+            { kmer_s("cat"), 10 },
+            { kmer_s("cgc"), 10 },
+            { kmer_s("cgt"), 10 },
+            { kmer_s("ctt"), 12 },
+            { kmer_s("gct"), 11 },
+            { kmer_s("gtt"), 11 },
+            { kmer_s("ttt"), 12 },
+            { kmer_s("acgt"), 4 },
+            { kmer_s("catt"), 17 },
+            { kmer_s("cgta"), 5 },
+            { kmer_s("gcat"), 16 },
+            { kmer_s("gtac"), 6 },
+            { kmer_s("gtac"), 7 },
+            { kmer_s("taca"), 8 },
+            { kmer_s("taca"), 9 },
+            { kmer_s("tacg"), 8 },
+            { kmer_s("tacg"), 9 },
+            { kmer_s("tgca"), 15 },
+            { kmer_s("ttgc"), 14 },
+        }));
+    });
 });
@@ -0,0 +1,134 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "testlib/test.h"
+#include "testlib/trie/trie_data.h"
+
+using triegraph::dna::CfgFlags;
+static constexpr triegraph::u32 FLAGS = CfgFlags::TD_SORTED_VECTOR | CfgFlags::VP_DUAL_IMPL;
+using TG = triegraph::Manager<triegraph::dna::DnaConfig<0, FLAGS>>;
+using TGC = triegraph::Manager<triegraph::dna::DnaConfig<0, FLAGS | CfgFlags::TD_CANONICAL>>;
+
+template <typename M>
+static auto make_graph(bool rc = true) {
+    return typename M::Graph::Builder({ .add_reverse_complement = rc })
+        .add_node(typename M::Str("acgtacggtaccagt"), "s1")
+        .add_node(typename M::Str("ggatt"), "s2")
+        .add_node(typename M::Str("tttcagtcaggcatg"), "s3")
+        .add_node(typename M::Str("acgt"), "s4")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s3")
+        .add_edge("s3", "s4")
+        .build();
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("matches full", [] {
+    auto g = make_graph<TG>();
+    auto lloc = TG::LetterLocData(g);
+    auto td = test::td_from_graph<TG>(g, lloc);
+
+    auto gc = make_graph<TGC>();
+    auto llocc = TGC::LetterLocData(gc);
+    auto tdc = test::td_from_graph<TGC>(gc, llocc);
+
+    assert(tdc.trie2graph.size() < td.trie2graph.size());
+
+    for (auto kh : td.trie2graph.keys()) {
+        auto kmer = TG::KmerCodec::to_ext(kh);
+        auto ckmer = TGC::KmerCodec::to_ext(kh);
+        assert(tdc.t2g_contains(ckmer, llocc));
+        assert(test::equal_sorted(
+                    tdc.t2g_values_for(ckmer, llocc),
+                    test::sorted(td.t2g_values_for(kmer))));
+    }
+    for (TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc) {
+        std::vector<TG::KmerHolder> full, canon;
+        for (auto kmer : td.g2t_values_for(loc))
+            full.push_back(kmer.data);
+        for (auto kmer : tdc.g2t_values_for(loc, llocc))
+            canon.push_back(kmer.data);
+        assert(test::equal_sorted(canon, test::sorted(full)));
+    }
+    assert(tdc.active_trie.present == td.active_trie.present);
+    assert(!tdc.t2g_contains(TGC::Kmer::from_str("cccc"), llocc));
+
+    auto tg = TG::TrieGraph(TG::TrieGraphData(g, lloc, td));
+    auto tgc = TGC::TrieGraph(TGC::TrieGraphData(gc, llocc, tdc));
+    auto edges = [](const auto &tg, auto h) {
+        std::vector<std::string> res;
+        for (const auto &e : tg.next_edit_edges(h))
+            res.push_back((std::ostringstream() << e).str());
+        std::ranges::sort(res);
+        return res;
+    };
+    for (auto kh : td.trie2graph.keys()) {
+        auto h = TG::Handle(TG::KmerCodec::to_ext(kh));
+        auto hc = TGC::Handle(TGC::KmerCodec::to_ext(kh));
+        assert(edges(tg, h) == edges(tgc, hc));
+        h.kmer().pop(); hc.kmer().pop();
+        assert(edges(tg, h) == edges(tgc, hc));
+    }
+    auto prev = [](auto &tg, auto h) {
+        std::vector<std::string> res;
+        for (auto ph : tg.prev_trie_handles(h))
+            res.push_back((std::ostringstream() << ph).str());
+        std::ranges::sort(res);
+        return res;
+    };
+    for (TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+        assert(prev(tg, TG::Handle(lloc.expand(loc))) ==
+                prev(tgc, TGC::Handle(llocc.expand(loc))));
+});
+
+test::define_test("reverse complement", [] {
+    auto g = make_graph<TGC>();
+    auto lloc = TGC::LetterLocData(g);
+    auto td = test::td_from_graph<TGC>(g, lloc);
+
+    // "cggt" is inside s1, but not canonical, so it is only stored as "accg"
+    // in the mirror of s1
+    auto kmer = TGC::Kmer::from_str("cggt");
+    assert(!kmer.is_canonical());
+    assert(!td.t2g_contains(kmer));
+    auto locs = test::sorted(td.t2g_values_for(kmer, lloc));
+    assert(locs.size() == 1);
+    auto np = lloc.expand(locs[0]);
+    assert(np.node == 0);
+    auto seg = g.node(np.node).seg.get_view(np.pos - 4, 4);
+    assert(seg.to_str() == kmer.to_str());
+});
+
+test::define_test("needs reverse complement", [] {
+    auto g = make_graph<TGC>(false);
+    auto lloc = TGC::LetterLocData(g);
+    assert(test::throws_ccp([&] { test::td_from_graph<TGC>(g, lloc); },
+                "canonical-kmers-need-reverse-complement"));
+});
+
+test::define_test("update", [] {
+    auto g = make_graph<TGC>();
+    auto lloc = TGC::LetterLocData(g);
+    auto td = test::td_from_graph<TGC>(g, lloc);
+    auto expected = test::td_from_graph<TGC>(g, lloc);
+
+    auto res = TGC::update_triedata(std::move(td), g, lloc, g, lloc,
+            std::vector<TGC::NodeLoc> { 0, 2 });
+    assert(std::ranges::equal(res.trie2graph.keys(), expected.trie2graph.keys()));
+    assert(res.trie2graph.size() == expected.trie2graph.size());
+    assert(res.active_trie.present == expected.active_trie.present);
+});
+
+});
@@ -250,4 +250,14 @@ test::define_test("compressed_4x2", [] {
     }
 });
 
+test::define_test("rev_comp", [] {
+    DnaKmer::set_settings({ .trie_depth = 5 });
+    auto kmer = DnaKmer::from_str("aacgt");
+    assert(kmer.rev_comp().to_str() == "acgtt");
+    assert(kmer.rev_comp().rev_comp() == kmer);
+    assert(kmer.is_canonical());
+    assert(!kmer.rev_comp().is_canonical());
+    assert(DnaKmer::from_str("tacgt").rev_comp().is_canonical());
+});
+
 });
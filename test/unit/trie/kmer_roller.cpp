@@ -0,0 +1,80 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/trie/kmer_roller.h"
+#include "triegraph/trie/kmer.h"
+#include "triegraph/trie/dkmer.h"
+#include "triegraph/alphabet/dna_letter.h"
+#include "triegraph/alphabet/str.h"
+
+#include "testlib/test.h"
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace triegraph;
+using dna::DnaLetter;
+
+using DnaStr = Str<DnaLetter, u32>;
+using DnaKmer = DKmer<DnaLetter, u32>;
+using DnaKmer7 = Kmer<DnaLetter, u64, 7, u64(1) << 63>;
+
+static const std::string SEQ =
+    "acgtacgttgcaggctaacgtatcgatcgatgctagctagcatgactgactgatcgtagctagcaa";
+
+template <typename Kmer>
+static void check_walk(const DnaStr &s, Kmer kmer, u64 start, u64 end) {
+    auto ref = kmer;
+    std::vector<std::pair<u64, u64>> expected, got;
+    for (u64 i = start; i < end; ++i) {
+        ref.push_back(s[i-1]);
+        if (ref.is_complete())
+            expected.emplace_back(ref.data, i);
+    }
+    KmerRoller<Kmer>::walk(kmer, s, start, end, [&](const Kmer &k, u64 i) {
+        got.emplace_back(k.data, i);
+    });
+    assert(got == expected);
+    assert(kmer.data == ref.data);
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("walk dkmer", [] {
+    DnaKmer::set_settings({ .trie_depth = 5 });
+    DnaStr s(SEQ);
+    for (u64 start = 1; start < 20; ++start) {
+        check_walk(s, DnaKmer::empty(), start, s.size());
+        check_walk(s, DnaKmer::from_str("acg"), start, start + 4);
+        check_walk(s, DnaKmer::from_str("ttgca"), start, s.size());
+    }
+});
+
+test::define_test("walk fixed kmer", [] {
+    DnaStr s(SEQ);
+    for (u64 start = 1; start < 20; ++start) {
+        check_walk(s, DnaKmer7::empty(), start, s.size());
+        check_walk(s, DnaKmer7::from_str("tgcagga"), start, s.size());
+    }
+});
+
+test::define_test("append", [] {
+    DnaKmer::set_settings({ .trie_depth = 5 });
+    DnaStr s(SEQ);
+    for (u64 pos = 0; pos + 8 < s.size(); ++pos) {
+        for (u64 n = 0; n < 8; ++n) {
+            for (auto init : { "", "a", "gat", "cgtag" }) {
+                auto kmer = DnaKmer::from_str(init);
+                auto ref = kmer;
+                for (u64 i = 0; i < n; ++i)
+                    ref.push_back(s[pos + i]);
+                KmerRoller<DnaKmer>::append(kmer, s, pos, n);
+                assert(kmer.data == ref.data);
+            }
+        }
+    }
+});
+
+});
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "testlib/test.h"
+#include "testlib/trie/trie_data.h"
+
+using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+
+static constexpr triegraph::u16 K = 4;
+
+static TG::TrieData build_sampled(const TG::Graph &g, const TG::LetterLocData &lloc,
+        TG::NodeLoc every) {
+    auto ks = TG::KmerSettings::from_depth<TG::KmerHolder>(K);
+    auto pairs = TG::graph_to_sampled_pairs<TG::TrieBuilderPBFS>(g, lloc, ks, {}, every);
+    pairs.sort_by_rev().unique();
+    return TG::pairs_to_triedata(std::move(pairs), lloc);
+}
+
+struct Occurrence {
+    std::vector<TG::LetterLoc> path; // the locations of the letters
+    std::vector<TG::LetterLoc> next; // right after the last letter
+};
+
+// all strings of len (> K) letters spelled from np
+static void spell(const TG::Graph &g, const TG::LetterLocData &lloc,
+        TG::NodePos np, std::string &cur, std::vector<TG::LetterLoc> &path,
+        size_t len, std::map<std::string, std::vector<Occurrence>> &res) {
+    const auto &seg = g.node(np.node).seg;
+    cur.push_back(TG::Str::Letter::Codec::to_ext(seg[np.pos]));
+    path.push_back(lloc.compress(np));
+    std::vector<TG::NodePos> next;
+    if (np.pos + 1 < seg.size())
+        next.emplace_back(np.node, np.pos + 1);
+    else
+        for (const auto &fwd : g.forward_from(np.node))
+            next.emplace_back(fwd.node_id, 0);
+    if (cur.size() == len) {
+        // the last letter may be the last one of a sink node
+        auto &o = res[cur].emplace_back(Occurrence { path, {} });
+        for (auto n : next)
+            o.next.push_back(lloc.compress(n));
+    } else {
+        for (auto n : next)
+            spell(g, lloc, n, cur, path, len, res);
+    }
+    path.pop_back();
+    cur.pop_back();
+}
+
+// does the sampled TrieData have one of the first every kmers of o
+static bool has_sample(const TG::TrieData &sampled, const std::string &q,
+        const Occurrence &o, TG::NodeLoc every) {
+    for (size_t i = 0; i < every && i + K <= q.size(); ++i) {
+        auto kmer = TG::Kmer::from_str(q.substr(i, K));
+        auto afters = i + K < q.size() ? std::vector { o.path[i + K] } : o.next;
+        for (auto loc : afters)
+            if (std::ranges::count(sampled.t2g_values_for(kmer), loc))
+                return true;
+    }
+    return false;
+}
+
+static void check(const TG::Graph &g, TG::NodeLoc every) {
+    auto lloc = TG::LetterLocData(g);
+    auto full = test::td_from_graph<TG>(g, lloc, K);
+    auto sampled = build_sampled(g, lloc, every);
+    assert(sampled.trie2graph.size() < full.trie2graph.size());
+
+    std::map<std::string, std::vector<Occurrence>> occ;
+    std::string cur;
+    std::vector<TG::LetterLoc> path;
+    for (TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+        spell(g, lloc, lloc.expand(loc), cur, path, K + every - 1, occ);
+
+    auto lookup = TG::SampledLookup(g, lloc, sampled, every);
+    for (auto &[q, occs] : occ) {
+        // kmers ending a sink node have no location, so an occurrence
+        // sampled only there can't be found -- all others must be
+        std::vector<TG::LetterLoc> locs;
+        for (const auto &o : occs) {
+            if (has_sample(sampled, q, o, every))
+                locs.push_back(o.path[K]);
+            else
+                assert(o.next.empty());
+        }
+        auto query = TG::Str(q);
+        auto got = lookup.locations_for(query.get_view());
+        std::ranges::sort(locs);
+        locs.erase(std::unique(locs.begin(), locs.end()), locs.end());
+        assert(got == locs);
+        // the same as the full TrieData, for occurrences of the whole query
+        for (auto loc : got)
+            assert(std::ranges::count(full.t2g_values_for(
+                            TG::Kmer::from_sv(query.get_view(0, K))), loc) == 1);
+    }
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("linear", [] {
+    auto g = TG::Graph::Builder({
+            .add_reverse_complement = false,
+            .add_extends = false })
+        .add_node(TG::Str("acgtacggtaccagttgcaaggat"), "s1")
+        .build();
+    check(g, 2);
+    check(g, 3);
+    check(g, 5);
+});
+
+test::define_test("nonlinear", [] {
+    auto g = TG::Graph::Builder({
+            .add_reverse_complement = false,
+            .add_extends = false })
+        .add_node(TG::Str("acgtacgga"), "s1")
+        .add_node(TG::Str("ggat"), "s2")
+        .add_node(TG::Str("t"), "s3")
+        .add_node(TG::Str("cagtca"), "s4")
+        .add_node(TG::Str("aac"), "s5")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s4")
+        .add_edge("s3", "s4")
+        .add_edge("s3", "s5")
+        .add_edge("s5", "s4")
+        .build();
+    check(g, 2);
+    check(g, 3);
+});
+
+});
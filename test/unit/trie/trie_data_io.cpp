@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+
+#include "testlib/test.h"
+#include "testlib/tmp_file.h"
+#include "testlib/trie/trie_data.h"
+
+using triegraph::dna::CfgFlags;
+using triegraph::dna::DnaConfig;
+
+template <typename TG>
+static auto make_graph(const std::string &tail = "tttcagtcaggcatg") {
+    return typename TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(typename TG::Str("acgtacggtaccagt"), "s1")
+        .add_node(typename TG::Str("ggatt"), "s2")
+        .add_node(typename TG::Str(tail), "s3")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s3")
+        .build();
+}
+
+// loaded TrieData answers all queries like the saved one
+template <typename TG>
+static void check_save_load(const std::string &name) {
+    TG::kmer_set_depth(4);
+    auto g = make_graph<TG>();
+    auto lloc = typename TG::LetterLocData(g);
+    auto td = test::td_from_graph<TG>(g, lloc);
+
+    auto path = test::tmp_file(name);
+    td.save(path, lloc);
+    auto ld = TG::TrieData::load(path, lloc);
+    std::filesystem::remove(path);
+
+    assert(ld.trie2graph.size() == td.trie2graph.size());
+    assert(ld.graph2trie.size() == td.graph2trie.size());
+    assert(std::ranges::equal(ld.trie2graph.keys(), td.trie2graph.keys()));
+    for (auto kh : td.trie2graph.keys()) {
+        auto kmer = TG::KmerCodec::to_ext(kh);
+        assert(std::ranges::equal(ld.t2g_values_for(kmer), td.t2g_values_for(kmer)));
+    }
+    for (typename TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+        assert(std::ranges::equal(ld.g2t_values_for(loc), td.g2t_values_for(loc)));
+    assert(ld.active_trie.present == td.active_trie.present);
+}
+
+// a cut off file fails to load, instead of reading (or mapping) past its end
+template <typename TG>
+static void check_truncated(const std::string &name) {
+    TG::kmer_set_depth(4);
+    auto g = make_graph<TG>();
+    auto lloc = typename TG::LetterLocData(g);
+    auto td = test::td_from_graph<TG>(g, lloc);
+    auto path = test::tmp_file(name);
+    td.save(path, lloc);
+    // cut at the start of the last section's elements
+    auto size = std::filesystem::file_size(path);
+    assert(size % triegraph::BINARY_IO_SECTION_ALIGN != 0);
+    std::filesystem::resize_file(path,
+            size / triegraph::BINARY_IO_SECTION_ALIGN * triegraph::BINARY_IO_SECTION_ALIGN);
+    bool thrown = test::throws_ccp([&] { TG::TrieData::load(path, lloc); },
+            "binary-io-truncated");
+    std::filesystem::remove(path);
+    assert(thrown);
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("sorted vector starts", [] {
+    check_save_load<triegraph::Manager<DnaConfig<0>>>("sv");
+});
+
+test::define_test("compact elems", [] {
+    check_save_load<triegraph::Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR |
+        CfgFlags::VP_DUAL_IMPL | CfgFlags::CV_ELEMS>>>("cv");
+});
+
+test::define_test("vector starts", [] {
+    check_save_load<triegraph::Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::VP_DUAL_IMPL>>>("vec");
+});
+
+test::define_test("mapped", [] {
+    check_save_load<triegraph::Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR |
+        CfgFlags::VP_DUAL_IMPL | CfgFlags::TD_VM_VECTOR>>>("vm");
+});
+
+test::define_test("mapped compact elems", [] {
+    check_save_load<triegraph::Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR |
+        CfgFlags::VP_DUAL_IMPL | CfgFlags::CV_ELEMS |
+        CfgFlags::TD_VM_VECTOR>>>("vmcv");
+});
+
+test::define_test("truncated", [] {
+    check_truncated<triegraph::Manager<DnaConfig<0>>>("trunc");
+    check_truncated<triegraph::Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR |
+        CfgFlags::VP_DUAL_IMPL | CfgFlags::TD_VM_VECTOR>>>("truncvm");
+});
+
+test::define_test("other graph", [] {
+    using TG = triegraph::Manager<DnaConfig<0>>;
+    TG::kmer_set_depth(4);
+    auto g = make_graph<TG>();
+    auto lloc = TG::LetterLocData(g);
+    auto td = test::td_from_graph<TG>(g, lloc);
+    auto path = test::tmp_file("other");
+    td.save(path, lloc);
+
+    auto g2 = make_graph<TG>("tttcagtcaggcatgaa");
+    auto lloc2 = TG::LetterLocData(g2);
+    bool thrown = false;
+    try {
+        TG::TrieData::load(path, lloc2);
+    } catch (const char *) {
+        thrown = true;
+    }
+    std::filesystem::remove(path);
+    assert(thrown);
+});
+
+test::define_test("other config", [] {
+    using TG = triegraph::Manager<DnaConfig<0>>;
+    using TGA = triegraph::Manager<DnaConfig<0, CfgFlags::ALLOW_INNER_KMER |
+        CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR | CfgFlags::VP_DUAL_IMPL>>;
+    TG::kmer_set_depth(4);
+    TGA::kmer_set_depth(4);
+    auto g = make_graph<TG>();
+    auto lloc = TG::LetterLocData(g);
+    auto td = test::td_from_graph<TG>(g, lloc);
+    auto path = test::tmp_file("config");
+    td.save(path, lloc);
+
+    auto ga = make_graph<TGA>();
+    auto lloca = TGA::LetterLocData(ga);
+    bool thrown = false;
+    try {
+        TGA::TrieData::load(path, lloca);
+    } catch (const char *) {
+        thrown = true;
+    }
+    std::filesystem::remove(path);
+    assert(thrown);
+});
+
+});
@@ -7,12 +7,44 @@
 #include "triegraph/manager.h"
 
 #include <algorithm>
+#include <vector>
 
 #include "testlib/test.h"
 
 // template <bool allow_inner>
 // struct Cfg : public triegraph::dna::DnaConfig<0, true, false>;
 
+// counting build gives the same TrieData as the pairs build
+template <typename TG, typename TrieBuilder = TG::TrieBuilderNBFS>
+static void check_counting_build(bool add_reverse_complement = false) {
+    auto g = typename TG::Graph::Builder({
+            .add_reverse_complement = add_reverse_complement })
+        .add_node(typename TG::Str("acgtacggtaccagt"), "s1")
+        .add_node(typename TG::Str("ggatt"), "s2")
+        .add_node(typename TG::Str("tttcagtcaggcatg"), "s3")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s3")
+        .build();
+    auto lloc = typename TG::LetterLocData(g);
+    auto ks = TG::KmerSettings::template from_depth<typename TG::KmerHolder>(4);
+    auto pairs = TG::template graph_to_pairs<TrieBuilder>(g, lloc, ks, {}, lloc);
+    auto td = TG::pairs_to_triedata(std::move(pairs), lloc);
+    auto tdc = TG::template graph_to_triedata_counting<TrieBuilder>(
+            g, lloc, ks, {}, lloc);
+
+    assert(tdc.trie2graph.size() == td.trie2graph.size());
+    assert(tdc.graph2trie.size() == td.graph2trie.size());
+    for (auto kh : td.trie2graph.keys()) {
+        auto kmer = TG::KmerCodec::to_ext(kh);
+        assert(std::ranges::equal(tdc.t2g_values_for(kmer),
+                    test::sorted(td.t2g_values_for(kmer))));
+    }
+    for (typename TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+        assert(std::ranges::equal(tdc.g2t_values_for(loc),
+                    td.g2t_values_for(loc)));
+}
+
 int m = test::define_module(__FILE__, [] {
 
 test::define_test("no_inner", [] {
@@ -89,4 +121,179 @@ test::define_test("with_inner", [] {
     assert( td.trie_contains(kmer_s("acg")));
 });
 
+test::define_test("dual matches simple", [] {
+    using triegraph::dna::CfgFlags;
+    using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+    using TGS = triegraph::Manager<triegraph::dna::DnaConfig<0,
+          CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR>>;
+    static_assert(TG::VectorPairs::impl == triegraph::VectorPairsImpl::DUAL);
+    static_assert(TGS::VectorPairs::impl == triegraph::VectorPairsImpl::SIMPLE);
+
+    auto g = TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str("acgtacggtaccagt"), "s1")
+        .add_node(TG::Str("ggatt"), "s2")
+        .add_node(TG::Str("tttcagtcaggcatg"), "s3")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s3")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+    auto ks = TG::KmerSettings::from_depth<TG::KmerHolder>(4);
+    auto pairs = TG::graph_to_pairs<TG::TrieBuilderNBFS>(g, lloc, ks, {}, lloc);
+    auto spairs = TGS::VectorPairs {};
+    for (const auto &p : pairs.fwd_pairs()) {
+        // with some duplicates
+        spairs.emplace_back(p.first, p.second);
+        pairs.emplace_back(p.first, p.second);
+    }
+    auto td = TG::pairs_to_triedata(std::move(pairs), lloc);
+    auto tds = TGS::TrieData(std::move(spairs), lloc);
+
+    assert(td.trie2graph.size() == tds.trie2graph.size());
+    assert(td.graph2trie.size() == tds.graph2trie.size());
+    for (auto kh : tds.trie2graph.keys()) {
+        auto kmer = TG::KmerCodec::to_ext(kh);
+        // transposed in loc order, so values are sorted
+        assert(std::ranges::equal(td.t2g_values_for(kmer),
+                    test::sorted(tds.t2g_values_for(kmer))));
+    }
+    for (TG::LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+        assert(std::ranges::equal(td.g2t_values_for(loc),
+                    tds.g2t_values_for(loc)));
+});
+
+test::define_test("counting build", [] {
+    using triegraph::dna::CfgFlags;
+    using triegraph::dna::DnaConfig;
+    using triegraph::Manager;
+    check_counting_build<Manager<DnaConfig<0>>>();
+    check_counting_build<Manager<DnaConfig<0>>,
+        Manager<DnaConfig<0>>::TrieBuilderNBFSPar>();
+    check_counting_build<Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR>>>();
+    check_counting_build<Manager<DnaConfig<0,
+        CfgFlags::VP_DUAL_IMPL | CfgFlags::CV_ELEMS>>>();
+    check_counting_build<Manager<DnaConfig<0,
+        CfgFlags::USE_DNAN | CfgFlags::VP_DUAL_IMPL | CfgFlags::TD_CANONICAL>>>(true);
+});
+
+test::define_test("counting build from config", [] {
+    using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+    auto g = TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str("acgtacgt"), "s1")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+    auto td = TG::graph_to_triedata<TG::TrieBuilderBT>(g, lloc, triegraph::MapCfg {
+            "trie-depth", "4", "trie-data-counting-build", "1" });
+    using vec_l = std::vector<TG::LetterLoc>;
+    assert(std::ranges::equal(
+                td.t2g_values_for(TG::Kmer::from_str("acgt")), vec_l { 4, 8 }));
+    assert(std::ranges::equal(
+                td.t2g_values_for(TG::Kmer::from_str("tacg")), vec_l { 7 }));
+});
+
+test::define_test("counting build mismatch", [] {
+    using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+    TG::kmer_set_depth(4);
+    auto g = TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str("acgtacgt"), "s1")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+    // the second pass puts a pair at another location
+    int pass = 0;
+    bool thrown = false;
+    try {
+        TG::TrieData::counting_build([&pass](auto &sink) {
+            sink.emplace_back(1, 4);
+            sink.emplace_back(2, pass++ ? 6 : 5);
+        }, lloc);
+    } catch (const char *) {
+        thrown = true;
+    }
+    assert(thrown);
+});
+
+test::define_test("counting build kmer mismatch", [] {
+    using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+    TG::kmer_set_depth(4);
+    auto g = TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str("acgtacgt"), "s1")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+    // the second pass puts another kmer at the same location
+    int pass = 0;
+    bool thrown = false;
+    try {
+        TG::TrieData::counting_build([&pass](auto &sink) {
+            sink.emplace_back(1, 4);
+            sink.emplace_back(pass++ ? 3 : 2, 5);
+        }, lloc);
+    } catch (const char *) {
+        thrown = true;
+    }
+    assert(thrown);
+});
+
+test::define_test("vm vector pairs", [] {
+    using triegraph::dna::CfgFlags;
+    using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+    using TGV = triegraph::Manager<triegraph::dna::DnaConfig<0,
+          CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR | CfgFlags::VP_DUAL_IMPL |
+          CfgFlags::VP_VM_VECTOR | CfgFlags::CV_ELEMS>>;
+
+    auto g = TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str("acgtacggtaccagt"), "s1")
+        .add_node(TG::Str("ggatt"), "s2")
+        .add_node(TG::Str("tttcagtcaggcatg"), "s3")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s3")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+    auto ks = TG::KmerSettings::from_depth<TG::KmerHolder>(4);
+    auto td = TG::pairs_to_triedata(
+            TG::graph_to_pairs<TG::TrieBuilderNBFS>(g, lloc, ks, {}, lloc), lloc);
+    auto tdv = TGV::pairs_to_triedata(
+            TGV::graph_to_pairs<TGV::TrieBuilderNBFS>(g, lloc, ks, {}, lloc), lloc);
+
+    assert(td.trie2graph.size() == tdv.trie2graph.size());
+    for (auto kh : td.trie2graph.keys()) {
+        auto kmer = TG::KmerCodec::to_ext(kh);
+        assert(std::ranges::equal(td.t2g_values_for(kmer), tdv.t2g_values_for(kmer)));
+    }
+});
+
+test::define_test("external pairs", [] {
+    using triegraph::dna::CfgFlags;
+    using TG = triegraph::Manager<triegraph::dna::DnaConfig<0,
+          CfgFlags::USE_DNAN | CfgFlags::TD_SORTED_VECTOR | CfgFlags::VP_EXTERNAL>>;
+    TG::kmer_set_depth(4);
+
+    auto g = TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str("acgtacgt"), "s1")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+
+    // a run per pair
+    auto vp = TG::VectorPairs({ .mem_budget = 1 });
+    auto vpi = TG::make_pairs_inserter(vp, TG::PairsVariantCompressed {});
+    std::ranges::copy(std::vector<std::pair<TG::Kmer, TG::LetterLoc>> {
+            { TG::Kmer::from_str("gtac"), 6 },
+            { TG::Kmer::from_str("acgt"), 8 },
+            { TG::Kmer::from_str("acgt"), 4 },
+            { TG::Kmer::from_str("acgt"), 8 },
+    }, std::back_inserter(vpi));
+    assert(vp.num_runs() == 4u);
+    auto td = TG::TrieData(std::move(vp), lloc);
+
+    using vec_l = std::vector<TG::LetterLoc>;
+    assert(test::equal_sorted(
+                td.t2g_values_for(TG::Kmer::from_str("acgt")), vec_l { 4, 8 }));
+    assert(test::equal_sorted(
+                td.t2g_values_for(TG::Kmer::from_str("gtac")), vec_l { 6 }));
+    assert(test::equal_sorted(
+                td.t2g_values_for(TG::Kmer::from_str("acgg")), vec_l { }));
+    assert(std::ranges::distance(td.g2t_values_for(8)) == 1);
+});
+
 });
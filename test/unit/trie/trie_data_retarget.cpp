@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "testlib/test.h"
+#include "testlib/trie/trie_data.h"
+
+using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+
+static auto make_graph(bool rc) {
+    return TG::Graph::Builder({
+            .add_reverse_complement = rc,
+            .add_extends = false })
+        .add_node(TG::Str("acgtacgga"), "s1")
+        .add_node(TG::Str("ggat"), "s2")
+        .add_node(TG::Str("t"), "s3")
+        .add_node(TG::Str("cagtca"), "s4")
+        .add_node(TG::Str("aac"), "s5")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s4")
+        .add_edge("s3", "s4")
+        .add_edge("s3", "s5")
+        .add_edge("s5", "s4")
+        .add_edge("s4", "s1")
+        .build();
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("grow", [] {
+    for (bool rc : { false, true }) {
+        auto g = make_graph(rc);
+        auto lloc = TG::LetterLocData(g);
+        auto expected = test::td_from_graph<TG>(g, lloc, 5);
+        auto td = TG::retarget_triedata(test::td_from_graph<TG>(g, lloc, 4), g, lloc, 5);
+        assert(TG::Kmer::K == 5);
+        assert(test::td_equal<TG>(td, expected, lloc));
+    }
+});
+
+test::define_test("shrink", [] {
+    for (bool rc : { false, true }) {
+        auto g = make_graph(rc);
+        auto lloc = TG::LetterLocData(g);
+        auto expected = test::td_from_graph<TG>(g, lloc, 3);
+        auto td = TG::retarget_triedata(test::td_from_graph<TG>(g, lloc, 4), g, lloc, 3);
+        assert(TG::Kmer::K == 3);
+        assert(test::td_equal<TG>(td, expected, lloc));
+    }
+});
+
+test::define_test("source kmers", [] {
+    // no loops, so shrinking has to add kmers at the start of s1
+    auto g = TG::Graph::Builder({
+            .add_reverse_complement = false,
+            .add_extends = false })
+        .add_node(TG::Str("acgtac"), "s1")
+        .add_node(TG::Str("g"), "s2")
+        .add_node(TG::Str("tt"), "s3")
+        .add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .build();
+    auto lloc = TG::LetterLocData(g);
+    auto expected = test::td_from_graph<TG>(g, lloc, 2);
+    auto td = TG::retarget_triedata(test::td_from_graph<TG>(g, lloc, 4), g, lloc, 2);
+    assert(test::td_equal<TG>(td, expected, lloc));
+});
+
+test::define_test("several steps", [] {
+    auto g = make_graph(true);
+    auto lloc = TG::LetterLocData(g);
+    auto expected = test::td_from_graph<TG>(g, lloc, 7);
+    auto td = TG::retarget_triedata(test::td_from_graph<TG>(g, lloc, 4), g, lloc, 7);
+    assert(test::td_equal<TG>(td, expected, lloc));
+    td = TG::retarget_triedata(std::move(td), g, lloc, 5);
+    expected = test::td_from_graph<TG>(g, lloc, 5);
+    assert(test::td_equal<TG>(td, expected, lloc));
+});
+
+});
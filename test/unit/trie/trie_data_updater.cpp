@@ -0,0 +1,119 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+
+#include <algorithm>
+#include <vector>
+
+#include "testlib/test.h"
+#include "testlib/trie/trie_data.h"
+
+using TG = triegraph::Manager<triegraph::dna::DnaConfig<0>>;
+
+static auto make_graph(bool rc, bool with_s5, bool with_s3_s4,
+        bool extends = false) {
+    auto b = TG::Graph::Builder({
+            .add_reverse_complement = rc,
+            .add_extends = extends });
+    b.add_node(TG::Str("acgtac"), "s1")
+        .add_node(TG::Str("ggat"), "s2")
+        .add_node(TG::Str("ttca"), "s3")
+        .add_node(TG::Str("cagt"), "s4");
+    if (with_s5)
+        b.add_node(TG::Str("aacc"), "s5");
+    b.add_edge("s1", "s2")
+        .add_edge("s1", "s3")
+        .add_edge("s2", "s4");
+    if (with_s3_s4)
+        b.add_edge("s3", "s4");
+    if (with_s5)
+        b.add_edge("s2", "s5").add_edge("s5", "s4");
+    return b.build();
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("add node", [] {
+    auto g_old = make_graph(false, false, true);
+    auto lloc_old = TG::LetterLocData(g_old);
+    auto td = test::td_from_graph<TG>(g_old, lloc_old);
+
+    auto g = make_graph(false, true, true);
+    auto lloc = TG::LetterLocData(g);
+    auto expected = test::td_from_graph<TG>(g, lloc);
+
+    // s2 and s4 got new edges, s5 is new
+    auto res = TG::update_triedata(std::move(td), g_old, lloc_old, g, lloc,
+            std::vector<TG::NodeLoc> { 1, 3 });
+    assert(test::td_equal<TG>(res, expected, lloc));
+});
+
+test::define_test("remove edge", [] {
+    auto g_old = make_graph(false, false, true);
+    auto lloc_old = TG::LetterLocData(g_old);
+    auto td = test::td_from_graph<TG>(g_old, lloc_old);
+
+    auto g = make_graph(false, false, false);
+    auto lloc = TG::LetterLocData(g);
+    auto expected = test::td_from_graph<TG>(g, lloc);
+    assert(!test::td_equal<TG>(td, expected, lloc));
+
+    auto res = TG::update_triedata(std::move(td), g_old, lloc_old, g, lloc,
+            std::vector<TG::NodeLoc> { 2, 3 });
+    assert(test::td_equal<TG>(res, expected, lloc));
+});
+
+test::define_test("reverse complement", [] {
+    auto g_old = make_graph(true, false, true);
+    auto lloc_old = TG::LetterLocData(g_old);
+    auto td = test::td_from_graph<TG>(g_old, lloc_old);
+
+    auto g = make_graph(true, true, true);
+    auto lloc = TG::LetterLocData(g);
+    auto expected = test::td_from_graph<TG>(g, lloc);
+
+    // complement nodes are marked automatically
+    auto res = TG::update_triedata(std::move(td), g_old, lloc_old, g, lloc,
+            std::vector<TG::NodeLoc> { 2, 6 });
+    assert(test::td_equal<TG>(res, expected, lloc));
+});
+
+// default graph settings: extend nodes shift when s5 is added, and s3 gets
+// one when it loses its out-edge
+test::define_test("extend nodes", [] {
+    for (bool with_s5 : { false, true }) {
+        auto g_old = make_graph(true, false, true, true);
+        auto lloc_old = TG::LetterLocData(g_old);
+        auto td = test::td_from_graph<TG>(g_old, lloc_old);
+
+        auto g = make_graph(true, with_s5, with_s5, true);
+        assert(g.num_original_nodes() + 2 < g.num_nodes());
+        auto lloc = TG::LetterLocData(g);
+        auto expected = test::td_from_graph<TG>(g, lloc);
+        assert(!test::td_equal<TG>(td, expected, lloc));
+
+        auto res = TG::update_triedata(std::move(td), g_old, lloc_old, g, lloc,
+                with_s5 ? std::vector<TG::NodeLoc> { 2, 6 } :
+                    std::vector<TG::NodeLoc> { 4, 6 });
+        assert(test::td_equal<TG>(res, expected, lloc));
+    }
+});
+
+test::define_test("old nodes must stay", [] {
+    auto g_old = make_graph(false, true, true);
+    auto lloc_old = TG::LetterLocData(g_old);
+    auto td = test::td_from_graph<TG>(g_old, lloc_old);
+
+    auto g = make_graph(false, false, true);
+    auto lloc = TG::LetterLocData(g);
+    assert(test::throws_ccp([&] {
+        TG::update_triedata(std::move(td), g_old, lloc_old, g, lloc,
+                std::vector<TG::NodeLoc> {});
+    }, "updated-graph-changes-old-nodes"));
+});
+
+});
@@ -0,0 +1,129 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/dna_config.h"
+#include "triegraph/manager.h"
+#include "triegraph/util/checkpoint.h"
+#include "triegraph/util/cmdline.h"
+
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+
+using namespace triegraph;
+using TG = Manager<dna::DnaConfig<0>>;
+
+static std::string tmp_dir(const std::string &name) {
+    auto dir = std::filesystem::temp_directory_path() /
+        ("triegraph-test-" + name + "-" + std::to_string(::getpid()));
+    std::filesystem::remove_all(dir);
+    return dir;
+}
+
+static TG::Graph make_graph(const std::string &s1 = "acgtacgtac") {
+    return TG::Graph::Builder({ .add_reverse_complement = false })
+        .add_node(TG::Str(s1), "s1")
+        .add_node(TG::Str("ttgca"), "s2")
+        .add_edge("s1", "s2")
+        .build();
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("save load", [] {
+    auto dir = tmp_dir("ckpt");
+    auto cp = Checkpoint({ .dir = dir }, 42);
+    assert(!cp.has("stage"));
+    assert(!cp.load("stage", [](BinaryReader &) { assert(false); }));
+
+    cp.save("stage", [](BinaryWriter &w) {
+        w.write_pod(u32(7));
+        w.write_pod(u64(1) << 40);
+    });
+    assert(cp.has("stage"));
+    assert(!std::filesystem::exists(cp.path("stage") + ".tmp"));
+
+    u32 a = 0; u64 b = 0;
+    assert(cp.load("stage", [&](BinaryReader &r) {
+        a = r.read_pod<u32>();
+        b = r.read_pod<u64>();
+    }));
+    assert(a == 7 && b == (u64(1) << 40));
+
+    // different inputs, stage is ignored
+    auto other = Checkpoint({ .dir = dir }, 43);
+    assert(!other.has("stage"));
+
+    cp.remove("stage");
+    assert(!cp.has("stage"));
+    std::filesystem::remove_all(dir);
+});
+
+test::define_test("disabled", [] {
+    auto cp = Checkpoint({}, 42);
+    assert(!cp.enabled());
+    cp.save("stage", [](BinaryWriter &) { assert(false); });
+    assert(!cp.has("stage"));
+});
+
+test::define_test("pipeline resume", [] {
+    auto dir = tmp_dir("pipeline");
+    auto cfg = MapCfg { "trie-depth", "4", "checkpoint-dir", dir };
+    auto g = make_graph();
+    auto lloc = TG::LetterLocData(g);
+
+    auto td = TG::graph_to_triedata<TG::TrieBuilderNBFS>(g, lloc, cfg);
+    auto cp = Checkpoint({ .dir = dir },
+            TG::_fingerprint<TG::TrieBuilderNBFS>(g, lloc, cfg));
+    assert(cp.has("sorted-pairs"));
+    assert(!cp.has("pairs"));
+
+    // same result, when resumed from the sorted pairs
+    auto td2 = TG::graph_to_triedata<TG::TrieBuilderNBFS>(g, lloc, cfg);
+    assert(std::ranges::equal(td.trie2graph, td2.trie2graph));
+    assert(std::ranges::equal(td.graph2trie, td2.graph2trie));
+
+    // the builder is skipped, whatever is in the checkpoint is used
+    auto pairs = TG::VectorPairs {};
+    TG::_vp_set_bits(pairs, lloc);
+    pairs.emplace_back(TG::KmerCodec::to_int(TG::Kmer::from_str("gggg")), 3);
+    TG::_save_pairs(cp, "sorted-pairs", pairs);
+    auto td3 = TG::graph_to_triedata<TG::TrieBuilderNBFS>(g, lloc, cfg);
+    assert(std::ranges::distance(td3.trie2graph) == 1);
+    assert(td3.t2g_contains(TG::Kmer::from_str("gggg")));
+
+    // a different config doesn't pick up the checkpoint
+    auto cfg2 = MapCfg { "trie-depth", "3", "checkpoint-dir", dir };
+    auto td4 = TG::graph_to_triedata<TG::TrieBuilderNBFS>(g, lloc, cfg2);
+    assert(std::ranges::distance(td4.trie2graph) > 1);
+
+    std::filesystem::remove_all(dir);
+});
+
+test::define_test("substituted letter", [] {
+    auto dir = tmp_dir("snp");
+    auto cfg = MapCfg { "trie-depth", "4", "checkpoint-dir", dir };
+    auto g = make_graph();
+    auto lloc = TG::LetterLocData(g);
+    TG::graph_to_triedata<TG::TrieBuilderNBFS>(g, lloc, cfg);
+
+    // same ids and lengths, one letter differs
+    auto g2 = make_graph("acgtaggtac");
+    auto lloc2 = TG::LetterLocData(g2);
+    assert(TG::_fingerprint<TG::TrieBuilderNBFS>(g, lloc, cfg) !=
+            TG::_fingerprint<TG::TrieBuilderNBFS>(g2, lloc2, cfg));
+
+    auto td = TG::graph_to_triedata<TG::TrieBuilderNBFS>(g2, lloc2, cfg);
+    auto expected = TG::graph_to_triedata<TG::TrieBuilderNBFS>(g2, lloc2,
+            MapCfg { "trie-depth", "4" });
+    assert(td.t2g_contains(TG::Kmer::from_str("tagg")));
+    assert(std::ranges::equal(td.trie2graph, expected.trie2graph));
+    assert(std::ranges::equal(td.graph2trie, expected.graph2trie));
+    std::filesystem::remove_all(dir);
+});
+
+});
@@ -12,6 +12,8 @@
 #include <utility>
 #include <iterator>
 #include <algorithm>
+#include <filesystem>
+#include <unistd.h>
 
 using namespace triegraph;
 using CV32 = CompactVector<u32>;
@@ -151,6 +153,117 @@ struct CompactVectorTester {
 
         assert(cv.size() == 3);
         assert(std::ranges::equal(cv, std::vector<typename CV::value_type> { 1, 2, 8 }));
+
+        cv.resize(1);
+        cv.resize(4);
+
+        assert(cv.size() == 4);
+        assert(std::ranges::equal(cv, std::vector<typename CV::value_type> { 1, 0, 0, 0 }));
+    }
+
+    static std::vector<typename CV::value_type> random_vals(u32 n) {
+        using T = CV::value_type;
+        std::vector<T> vals;
+        u64 x = 88172645463325252ull;
+        for (u32 i = 0; i < n; ++i) {
+            x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+            vals.push_back(T(x) & CV::mask_(bits));
+        }
+        return vals;
+    }
+
+    static void test_pack_unpack() {
+        auto vals = random_vals(1000);
+        for (u32 n : { 0u, 1u, 2u, 63u, 64u, 65u, 1000u }) {
+            auto cv = make_cv();
+            cv.pack(vals.data(), n);
+            assert(cv.size() == n);
+            assert(std::ranges::equal(cv, std::ranges::subrange(
+                            vals.begin(), vals.begin() + n)));
+            assert(std::ranges::equal(cv.unpack(), cv));
+
+            std::vector<typename CV::value_type> part(n / 2);
+            cv.unpack(n / 3, n / 3 + n / 2, part.data());
+            assert(std::ranges::equal(part, std::ranges::subrange(
+                            vals.begin() + n / 3, vals.begin() + n / 3 + n / 2)));
+
+            // push_back after pack keeps going
+            cv.push_back(1);
+            assert(cv.size() == n + 1 && cv[n] == 1);
+        }
+    }
+
+    static void test_pack_at() {
+        auto vals = random_vals(1000);
+        auto other = random_vals(1000);
+        for (u32 beg : { 0u, 1u, 5u, 63u, 64u, 333u })
+            for (u32 n : { 0u, 1u, 2u, 63u, 64u, 65u, 500u }) {
+                auto cv = make_cv();
+                cv.pack(vals);
+                cv.pack_at(beg, other.data(), n);
+                for (u32 i = 0; i < vals.size(); ++i)
+                    assert(cv[i] == (beg <= i && i < beg + n ? other[i - beg] : vals[i]));
+            }
+    }
+
+    static void test_bulk_sort() {
+        auto vals = random_vals(5000);
+        auto cv = make_cv();
+        for (auto v : vals)
+            cv.push_back(v);
+        compact_vector_sort(cv);
+        std::ranges::sort(vals);
+        assert(std::ranges::equal(cv, vals));
+    }
+
+    static void test_widen() {
+        using T = CV::value_type;
+        auto vals = random_vals(1000);
+        for (u32 nbits : { bits, std::min(bits + 7, CV::max_bits), CV::max_bits }) {
+            auto cv = make_cv();
+            cv.pack(vals);
+            cv.widen(nbits);
+            assert(compact_vector_get_bits(cv) == nbits);
+            assert(std::ranges::equal(cv, vals));
+            cv.push_back(T(CV::mask_(nbits)));
+            assert(cv[vals.size()] == T(CV::mask_(nbits)));
+            assert(cv[vals.size() - 1] == vals.back());
+        }
+    }
+
+    static void test_auto_widen() {
+        using T = CV::value_type;
+        auto cv = make_cv().set_auto_widen(true);
+        std::vector<T> vals;
+        for (u32 b = 1; b <= CV::max_bits; ++b) {
+            vals.push_back(T(CV::mask_(b)));
+            cv.push_back(vals.back());
+        }
+        assert(compact_vector_get_bits(cv) == CV::max_bits);
+        assert(std::ranges::equal(cv, vals));
+    }
+
+    static void test_save_load() {
+        auto path = std::filesystem::temp_directory_path() / ("triegraph-test-cv-" +
+                std::to_string(::getpid()) + "-" + std::to_string(bits));
+        for (u64 n : { 0, 1, 1000 }) {
+            auto vals = random_vals(n);
+            auto cv = make_cv();
+            cv.pack(vals);
+            {
+                BinaryWriter w(path);
+                cv.save(w);
+                w.close();
+            }
+            CV res;
+            BinaryReader r(path);
+            res.load(r);
+            assert(compact_vector_get_bits(res) == bits);
+            assert(std::ranges::equal(res, vals));
+            res.push_back(1);
+            assert(res.size() == n + 1 && res[n] == 1);
+        }
+        std::filesystem::remove(path);
     }
 
     static void define_tests() {
@@ -167,6 +280,12 @@ struct CompactVectorTester {
         test::define_test(pref + "concepts", &Self::test_concepts);
         test::define_test(pref + "small_sort", &Self::test_small_sort);
         test::define_test(pref + "push_back_resize", &Self::test_push_back_resize);
+        test::define_test(pref + "pack_unpack", &Self::test_pack_unpack);
+        test::define_test(pref + "pack_at", &Self::test_pack_at);
+        test::define_test(pref + "bulk_sort", &Self::test_bulk_sort);
+        test::define_test(pref + "widen", &Self::test_widen);
+        test::define_test(pref + "auto_widen", &Self::test_auto_widen);
+        test::define_test(pref + "save_load", &Self::test_save_load);
     }
 };
 
@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/util/compact_vector.h"
+#include "triegraph/util/concurrent_pairs_sink.h"
+#include "triegraph/util/vector_pairs.h"
+#include "triegraph/util/vm_vector.h"
+
+#include <algorithm>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace triegraph;
+
+template <typename VP>
+static void fill_and_check(VP proto, u32 num_threads, u32 per_thread) {
+    ConcurrentPairsSink<VP> sink(std::move(proto));
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < num_threads; ++t) {
+        threads.emplace_back([&sink, t, per_thread] {
+            for (u32 i = 0; i < per_thread; ++i)
+                sink.emplace_back(i % 1000, t * per_thread + i);
+        });
+    }
+    for (auto &th : threads)
+        th.join();
+    assert(sink.size() == num_threads * per_thread);
+
+    VP pairs = sink.take();
+    assert(pairs.size() == num_threads * per_thread);
+    pairs.sort_by_rev();
+    u32 idx = 0;
+    for (const auto &[a, b] : pairs.fwd_pairs()) {
+        assert(b == idx);
+        assert(a == (idx % per_thread) % 1000);
+        ++idx;
+    }
+}
+
+int m = test::define_module(__FILE__, [] {
+
+using VP = VectorPairsDual<u32, u32>;
+using CV = CompactVector<u32>;
+using VPC = VectorPairsDual<u32, u32, CV, CV>;
+using VCV = CompactVector<u32, VmVector<u32>>;
+using VPVM = VectorPairsDual<u32, u32, VCV, VCV>;
+
+test::define_test("empty", [] {
+    ConcurrentPairsSink<VP> sink;
+    assert(sink.size() == 0);
+    assert(sink.take().size() == 0);
+});
+
+test::define_test("single thread", [] {
+    ConcurrentPairsSink<VP> sink;
+    for (u32 i = 0; i < 10; ++i)
+        sink.emplace_back(i, i * 2);
+    auto pairs = sink.take();
+    assert(pairs.size() == 10);
+    for (u32 i = 0; i < 10; ++i)
+        assert(pairs.get_v1()[i] == i && pairs.get_v2()[i] == i * 2);
+});
+
+test::define_test("threads, partial chunks", [] {
+    // every thread leaves a partly filled chunk, which take() stitches
+    fill_and_check(VP {}, 4, 3 * ConcurrentPairsSink<VP>::CHUNK / 2 + 17);
+});
+
+test::define_test("compact columns", [] {
+    VPC proto;
+    proto.get_v1().set_bits(10);
+    proto.get_v2().set_bits(20);
+    fill_and_check(std::move(proto), 3, ConcurrentPairsSink<VPC>::CHUNK + 5);
+});
+
+test::define_test("vm compact columns", [] {
+    VPVM proto;
+    proto.get_v1().set_bits(10);
+    proto.get_v2().set_bits(19);
+    fill_and_check(std::move(proto), 4, 100000);
+});
+
+test::define_test("value too wide", [] {
+    VPC proto;
+    proto.get_v1().set_bits(4);
+    proto.get_v2().set_bits(4);
+    ConcurrentPairsSink<VPC> sink(std::move(proto));
+    sink.emplace_back(15, 15);
+    bool thrown = false;
+    try {
+        sink.emplace_back(16, 1);
+    } catch (const char *) {
+        thrown = true;
+    }
+    assert(thrown);
+});
+
+test::define_test("reusable after take", [] {
+    ConcurrentPairsSink<VP> sink;
+    sink.emplace_back(1, 2);
+    assert(sink.take().size() == 1);
+    sink.emplace_back(3, 4);
+    auto pairs = sink.take();
+    assert(pairs.size() == 1);
+    assert(pairs.get_v1()[0] == 3);
+});
+
+});
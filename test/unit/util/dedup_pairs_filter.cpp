@@ -0,0 +1,115 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/util/cmdline.h"
+#include "triegraph/util/dedup_pairs_filter.h"
+#include "triegraph/util/vector_pairs.h"
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace triegraph;
+
+using VP = VectorPairsSimple<u32, u32>;
+using Filter = DedupPairsFilter<VP, u32, u32>;
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("disabled", [] {
+    VP vp;
+    Filter f(vp, {});
+    assert(!f.enabled());
+    f.emplace_back(1, 2);
+    f.emplace_back(1, 2);
+    assert(vp.size() == 2);
+    assert(f.stats().seen == 0);
+});
+
+test::define_test("drops repeats", [] {
+    VP vp;
+    Filter f(vp, { .bits = 10 });
+    for (u32 rep = 0; rep < 3; ++rep)
+        for (u32 i = 0; i < 100; ++i)
+            f.emplace_back(i, i % 7);
+    // 100 pairs don't collide much in 1024 slots, but might
+    assert(vp.size() >= 100 && vp.size() < 150);
+    auto stats = f.stats();
+    assert(stats.seen == 300);
+    assert(stats.dropped == 300 - vp.size());
+    assert(stats.ratio() > 0.5);
+    vp.sort_by_fwd().unique();
+    assert(vp.size() == 100);
+});
+
+test::define_test("only duplicates", [] {
+    VP vp;
+    Filter f(vp, { .bits = 1 });
+    // lots of collisions in 2 slots, but equal pairs only are dropped
+    for (u32 i = 0; i < 1000; ++i)
+        f.emplace_back(i % 13, i % 11);
+    vp.sort_by_fwd().unique();
+    assert(vp.size() == 143);
+});
+
+test::define_test("default settings", [] {
+    auto saved = DedupPairsSettings::default_settings();
+    DedupPairsSettings::default_settings() = DedupPairsSettings::from_config(
+            MapCfg { "trie-pairs-dedup-bits", "4" });
+    VP vp;
+    Filter f(vp);
+    DedupPairsSettings::default_settings() = saved;
+    assert(f.enabled());
+    f.emplace_back(3, 4);
+    f.emplace_back(3, 4);
+    assert(vp.size() == 1);
+});
+
+test::define_test("alternating filters", [] {
+    VP vp1, vp2;
+    Filter f1(vp1, { .bits = 4 });
+    Filter f2(vp2, { .bits = 4 });
+    // each switch misses the remembered cache, but finds this thread's one
+    for (u32 i = 0; i < 100; ++i) {
+        f1.emplace_back(3, 4);
+        f2.emplace_back(3, 4);
+    }
+    assert(vp1.size() == 1 && vp2.size() == 1);
+    assert(f1.stats().dropped == 99 && f2.stats().dropped == 99);
+});
+
+test::define_test("per thread caches", [] {
+    VP vp;
+    std::mutex mtx;
+    struct LockedSink {
+        VP &vp;
+        std::mutex &mtx;
+        size_t size() const { return vp.size(); }
+        void reserve(size_t) {}
+        void set_order(VectorPairsOrder) {}
+        void emplace_back(u32 a, u32 b) {
+            std::lock_guard<std::mutex> lk(mtx);
+            vp.emplace_back(a, b);
+        }
+    } sink { vp, mtx };
+    DedupPairsFilter<LockedSink, u32, u32> f(sink, { .bits = 8 });
+    std::vector<std::thread> threads;
+    for (u32 t = 0; t < 4; ++t)
+        threads.emplace_back([&f] {
+            for (u32 i = 0; i < 1000; ++i)
+                f.emplace_back(i % 10, 0);
+        });
+    for (auto &th : threads)
+        th.join();
+    // each thread passes each pair on once
+    assert(vp.size() == 40);
+    assert(f.stats().seen == 4000);
+    assert(f.stats().dropped == 3960);
+});
+
+});
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/util/generator.h"
+
+#include <algorithm>
+#include <ranges>
+#include <vector>
+
+using namespace triegraph;
+
+static Generator<int> iota(int n) {
+    for (int i = 0; i < n; ++i)
+        co_yield i;
+}
+
+static Generator<int> throws_after(int n) {
+    for (int i = 0; i < n; ++i)
+        co_yield i;
+    throw "boom";
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("empty", [] {
+    auto gen = iota(0);
+    assert(gen.begin() == gen.end());
+});
+
+test::define_test("values", [] {
+    static_assert(std::ranges::input_range<Generator<int>>);
+    auto gen = iota(5);
+    std::vector<int> res;
+    for (int x : gen)
+        res.push_back(x);
+    assert(std::ranges::equal(res, std::vector<int> { 0, 1, 2, 3, 4 }));
+});
+
+test::define_test("lazy", [] {
+    int runs = 0;
+    auto gen = [](int &runs) -> Generator<int> {
+        for (;;) {
+            ++runs;
+            co_yield runs;
+        }
+    }(runs);
+    assert(runs == 0);
+    auto it = gen.begin();
+    assert(runs == 1 && *it == 1);
+    ++it;
+    ++it;
+    assert(runs == 3 && *it == 3);
+});
+
+test::define_test("views", [] {
+    auto gen = iota(10);
+    std::vector<int> res;
+    for (int x : gen | std::views::filter([](int x) { return x % 3 == 0; }))
+        res.push_back(x);
+    assert(std::ranges::equal(res, std::vector<int> { 0, 3, 6, 9 }));
+});
+
+test::define_test("exception", [] {
+    auto gen = throws_after(2);
+    int seen = 0;
+    bool thrown = false;
+    try {
+        for (int x : gen)
+            seen += x + 1;
+    } catch (const char *) {
+        thrown = true;
+    }
+    assert(thrown && seen == 3);
+});
+
+test::define_test("move", [] {
+    auto a = iota(3);
+    auto b = std::move(a);
+    std::vector<int> res;
+    for (int x : b)
+        res.push_back(x);
+    assert(res.size() == 3 && res[2] == 2);
+});
+
+});
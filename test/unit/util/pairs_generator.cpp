@@ -0,0 +1,83 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/util/pairs_generator.h"
+
+#include <atomic>
+#include <utility>
+#include <vector>
+
+using namespace triegraph;
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("all pairs in order", [] {
+    auto gen = pairs_generator<u32, u32>([](auto &sink) {
+        for (u32 i = 0; i < 10000; ++i)
+            sink.emplace_back(i, i * 2);
+        assert(sink.size() == 10000);
+    }, 64, 2);
+    u32 i = 0;
+    for (const auto &p : gen) {
+        assert(p.first == i && p.second == i * 2);
+        ++i;
+    }
+    assert(i == 10000);
+});
+
+test::define_test("nothing", [] {
+    auto gen = pairs_generator<u32, u32>([](auto &) {});
+    assert(gen.begin() == gen.end());
+});
+
+test::define_test("bounded", [] {
+    // the producer can't run more than max_blocks (plus the one it fills, and
+    // the one being consumed) ahead
+    std::atomic<u32> produced = 0;
+    auto gen = pairs_generator<u32, u32>([&produced](auto &sink) {
+        for (u32 i = 0; i < 1000; ++i) {
+            sink.emplace_back(i, i);
+            ++produced;
+        }
+    }, 10, 2);
+    auto it = gen.begin();
+    assert(it != gen.end());
+    assert(produced <= 40);
+});
+
+test::define_test("producer exception", [] {
+    auto gen = pairs_generator<u32, u32>([](auto &sink) {
+        sink.emplace_back(1, 1);
+        throw "producer-failed";
+    }, 1);
+    u32 seen = 0;
+    bool thrown = false;
+    try {
+        for (const auto &p : gen)
+            seen += p.first;
+    } catch (const char *) {
+        thrown = true;
+    }
+    assert(thrown && seen == 1);
+});
+
+test::define_test("early stop", [] {
+    bool finished = false;
+    {
+        auto gen = pairs_generator<u32, u32>([&finished](auto &sink) {
+            for (u32 i = 0; i < 1000000; ++i)
+                sink.emplace_back(i, i);
+            finished = true;
+        }, 16, 1);
+        for (const auto &p : gen)
+            if (p.first == 100)
+                break;
+    }
+    assert(!finished);
+});
+
+});
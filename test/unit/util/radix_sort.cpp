@@ -0,0 +1,70 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/util/radix_sort.h"
+
+#include <algorithm>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace triegraph;
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("single key", [] {
+    std::mt19937 rng(42);
+    std::vector<u32> v(1000);
+    for (auto &x : v)
+        x = rng() & 0xfffff;
+    auto expected = v;
+    std::ranges::sort(expected);
+    radix_sort(v, [](u32 x) { return x; }, 20);
+    assert(v == expected);
+});
+
+test::define_test("lexicographic", [] {
+    std::mt19937 rng(7);
+    std::vector<std::pair<u32, u32>> v(1000);
+    for (auto &[a, b] : v) {
+        a = rng() % 50;
+        b = rng() % 3000;
+    }
+    auto expected = v;
+    std::ranges::sort(expected);
+    radix_sort(v, [](const auto &p) { return p.second; }, 12);
+    radix_sort(v, [](const auto &p) { return p.first; }, 6);
+    assert(v == expected);
+});
+
+test::define_test("stable", [] {
+    std::vector<std::pair<u32, u32>> v { {3, 0}, {1, 1}, {3, 2}, {0, 3}, {1, 4} };
+    radix_sort(v, [](const auto &p) { return p.first; }, 2);
+    assert(v == (std::vector<std::pair<u32, u32>> {
+                {0, 3}, {1, 1}, {1, 4}, {3, 0}, {3, 2} }));
+});
+
+test::define_test("columns", [] {
+    std::mt19937 rng(11);
+    for (u32 threads : { 1u, 4u }) {
+        std::vector<u32> keys(70000);
+        std::vector<u64> other(keys.size());
+        std::vector<std::pair<u32, u64>> expected;
+        for (u64 i = 0; i < keys.size(); ++i) {
+            keys[i] = rng() % 100000;
+            other[i] = i;
+            expected.emplace_back(keys[i], i);
+        }
+        // stable, so equal keys stay in index order
+        std::ranges::sort(expected);
+        radix_sort_columns(keys, other, threads);
+        for (u64 i = 0; i < keys.size(); ++i)
+            assert(keys[i] == expected[i].first && other[i] == expected[i].second);
+    }
+});
+
+});
@@ -5,17 +5,47 @@
 
 #include "triegraph/util/sorted_vector.h"
 #include "triegraph/util/util.h"
+#include "triegraph/util/vm_vector.h"
 
 #include "testlib/test.h"
 
 #include <vector>
 #include <algorithm>
+#include <filesystem>
+#include <unistd.h>
 
 using namespace triegraph;
 
 template <typename B, typename D>
 using SV = triegraph::SortedVector<B, D>;
 
+template <typename SortedVector>
+static void check_save_load() {
+    auto path = std::filesystem::temp_directory_path() /
+        ("triegraph-test-sv-" + std::to_string(::getpid()));
+    // some diffs overflow u8
+    auto elems = std::vector<u32> { 3, 3, 4, 900, 900, 1000, 1500, 1501, 70000 };
+    SortedVector sv(4);
+    for (auto el : elems)
+        sv.push_back(el);
+    {
+        BinaryWriter w(path);
+        sv.save(w);
+        w.close();
+    }
+    SortedVector res;
+    BinaryReader r(path);
+    res.load(r);
+    std::filesystem::remove(path);
+
+    assert(res.size() == elems.size());
+    assert(std::ranges::equal(res, elems));
+    assert(res.binary_search(1000) == 5);
+    // keeps building where it was
+    res.push_back(70300);
+    assert(res[elems.size()] == 70300);
+}
+
 int m = test::define_module(__FILE__, [] {
     test::define_test("small no of", [] {
         auto sv = SV<u32, u8>(4);
@@ -109,4 +139,12 @@ int m = test::define_module(__FILE__, [] {
             assert(sv[i] == exp[i]);
         }
     });
+
+    test::define_test("save load", [] {
+        check_save_load<SV<u32, u8>>();
+    });
+
+    test::define_test("vm save load", [] {
+        check_save_load<SortedVector<u32, u8, VmVector>>();
+    });
 });
@@ -0,0 +1,106 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+
+#include "triegraph/util/thread_pool.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+using namespace triegraph;
+
+// run(job) and return the message it threw (nullptr if none)
+static const char *run_catch(ThreadPool &pool, ThreadPool::Job job) {
+    try {
+        pool.run(std::move(job));
+    } catch (const char *e) {
+        return e;
+    }
+    return nullptr;
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("run", [] {
+    ThreadPool pool(4);
+    std::vector<std::atomic<u32>> hits(4);
+    pool.run([&](u32 tid) { ++hits[tid]; });
+    pool.run([&](u32 tid) { ++hits[tid]; });
+    for (auto &h : hits)
+        assert(h == 2);
+});
+
+test::define_test("parallel_for", [] {
+    ThreadPool pool(3);
+    std::vector<u32> out(1000);
+    pool.parallel_for(out.size(), 7, [&](u32, u64 beg, u64 end) {
+        for (u64 i = beg; i < end; ++i)
+            out[i] = i * 2;
+    });
+    for (u64 i = 0; i < out.size(); ++i)
+        assert(out[i] == i * 2);
+});
+
+test::define_test("worker throws", [] {
+    ThreadPool pool(4);
+    std::atomic<u32> done = 0;
+    auto e = run_catch(pool, [&](u32 tid) {
+        if (tid == 2)
+            throw "worker-failed";
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ++done;
+    });
+    assert(e && std::strcmp(e, "worker-failed") == 0);
+    // the others finished before run returned
+    assert(done == 3);
+
+    // and the pool is still usable
+    std::atomic<u32> again = 0;
+    pool.run([&](u32) { ++again; });
+    assert(again == 4);
+});
+
+test::define_test("caller throws", [] {
+    ThreadPool pool(4);
+    std::atomic<u32> done = 0;
+    auto e = run_catch(pool, [&](u32 tid) {
+        if (tid == 0)
+            throw "caller-failed";
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        ++done;
+    });
+    assert(e && std::strcmp(e, "caller-failed") == 0);
+    assert(done == 3);
+});
+
+test::define_test("parallel_for throws", [] {
+    ThreadPool pool(4);
+    std::atomic<u64> chunks = 0;
+    bool thrown = false;
+    try {
+        pool.parallel_for(100000, 1, [&](u32, u64 beg, u64) {
+            ++chunks;
+            if (beg == 10)
+                throw "chunk-failed";
+        });
+    } catch (const char *) {
+        thrown = true;
+    }
+    assert(thrown);
+    // the remaining chunks were dropped
+    assert(chunks < 100000);
+});
+
+test::define_test("single thread throws", [] {
+    ThreadPool pool(1);
+    auto e = run_catch(pool, [](u32) { throw "inline-failed"; });
+    assert(e && std::strcmp(e, "inline-failed") == 0);
+});
+
+});
@@ -7,7 +7,11 @@
 
 #include "triegraph/util/util.h"
 #include "triegraph/util/vector_pairs.h"
+#include "triegraph/util/vector_pairs_external.h"
 #include "triegraph/util/compact_vector.h"
+#include "triegraph/util/vm_vector.h"
+
+#include <random>
 
 using namespace triegraph;
 
@@ -48,6 +52,37 @@ static void test_non_empty(auto &&vp) {
                 {1, 1}, {2, 1}, {3, 0}, {5, 0}}));
 }
 
+static void test_order(auto &&vp) {
+    using VP = std::decay_t<decltype(vp)>;
+
+    vp.emplace_back(5, 1);
+    vp.emplace_back(3, 1);
+    vp.emplace_back(4, 2);
+    vp.emplace_back(1, 3);
+    vp.emplace_back(0, 3);
+    assert(vp.get_order() == VectorPairsOrder::NONE);
+
+    // pretend it is sorted by rev, sort_by_rev keeps it as is
+    vp.set_order(VectorPairsOrder::REV);
+    vp.sort_by_rev();
+    assert(std::ranges::equal(vp.fwd_pairs(), typename VP::fwd_vec {
+                {5, 1}, {3, 1}, {4, 2}, {1, 3}, {0, 3}}));
+
+    // grouped by second, sort_by_rev sorts within groups only
+    vp.set_order(VectorPairsOrder::REV_GROUPED);
+    vp.sort_by_rev();
+    assert(vp.get_order() == VectorPairsOrder::REV);
+    assert(std::ranges::equal(vp.fwd_pairs(), typename VP::fwd_vec {
+                {3, 1}, {5, 1}, {4, 2}, {0, 3}, {1, 3}}));
+
+    // adding resets the order
+    vp.emplace_back(0, 0);
+    assert(vp.get_order() == VectorPairsOrder::NONE);
+    vp.sort_by_rev();
+    assert(std::ranges::equal(vp.fwd_pairs(), typename VP::fwd_vec {
+                {0, 0}, {3, 1}, {5, 1}, {4, 2}, {0, 3}, {1, 3}}));
+}
+
 int m = test::define_module(__FILE__, [] {
 
 test::define_test("Empty impl", [] {
@@ -76,6 +111,14 @@ test::define_test("Dual impl", [] {
     test_non_empty(VectorPairsDual<u32, u32>());
 });
 
+test::define_test("Simple order", [] {
+    test_order(VectorPairsSimple<u32, u32>());
+});
+
+test::define_test("Dual order", [] {
+    test_order(VectorPairsDual<u32, u32>());
+});
+
 test::define_test("Dual take", [] {
     auto vp = VectorPairsDual<u32, u32>();
     vp.emplace_back(0, 5);
@@ -89,6 +132,27 @@ test::define_test("Dual take", [] {
     assert(std::ranges::equal(v2, std::vector<u32> { 5, 6 }));
 });
 
+test::define_test("Dual radix sort", [] {
+    using VP = VectorPairsDual<u32, u32>;
+    std::mt19937 rng(3);
+    for (u32 threads : { 1u, 3u }) {
+        auto vp = VP {};
+        vp.settings = { .sort_threads = threads, .radix_min_size = 0 };
+        auto ref = VectorPairsSimple<u32, u32>();
+        for (u32 i = 0; i < 100000; ++i) {
+            u32 a = rng() % 5000, b = rng() & 0xffffff;
+            vp.emplace_back(a, b);
+            ref.emplace_back(a, b);
+        }
+        vp.sort_by_fwd();
+        ref.sort_by_fwd();
+        assert(std::ranges::equal(vp.fwd_pairs(), ref.fwd_pairs()));
+        vp.sort_by_rev();
+        ref.sort_by_rev();
+        assert(std::ranges::equal(vp.rev_pairs(), ref.rev_pairs()));
+    }
+});
+
 test::define_test("Dual with CompactVector", [] {
     using VP = VectorPairsDual<u32, u32, CompactVector<u32>, CompactVector<u32>>;
     auto vp = VP {};
@@ -111,4 +175,146 @@ test::define_test("Dual with CompactVector", [] {
                 {0, 0}, {0, 1}, {1, 0}, {3, 1}, {3, 4} }));
 });
 
+test::define_test("Dual CompactVector sort", [] {
+    using VP = VectorPairsDual<u32, u32, CompactVector<u32>, CompactVector<u32>>;
+    std::mt19937 rng(5);
+    for (auto [radix_min, block] : { std::pair<u64, u64>
+            { 0, 1 << 20 }, { 1 << 20, 1 << 20 }, { 0, 1000 }, { 1 << 20, 7 } }) {
+        auto vp = VP {};
+        vp.settings = { .sort_threads = 1, .radix_min_size = radix_min,
+            .compact_sort_block = block };
+        compact_vector_set_bits(vp.get_v1(), 13);
+        compact_vector_set_bits(vp.get_v2(), 21);
+        auto ref = VectorPairsSimple<u32, u32>();
+        for (u32 i = 0; i < 50000; ++i) {
+            u32 a = rng() % 5000, b = rng() & 0x1fffff;
+            vp.emplace_back(a, b);
+            ref.emplace_back(a, b);
+        }
+        vp.sort_by_fwd();
+        ref.sort_by_fwd();
+        assert(std::ranges::equal(vp.fwd_pairs(), ref.fwd_pairs()));
+        vp.sort_by_rev();
+        ref.sort_by_rev();
+        assert(std::ranges::equal(vp.rev_pairs(), ref.rev_pairs()));
+        assert(compact_vector_get_bits(vp.get_v2()) == 21);
+    }
+});
+
+test::define_test("Dual with VmVector", [] {
+    using VP = VectorPairsDual<u32, u32, VmVector<u32>, VmVector<u32>>;
+    using VPC = VectorPairsDual<u32, u32,
+          CompactVector<u32, VmVector<u32>>, CompactVector<u32, VmVector<u32>>>;
+    std::mt19937 rng(9);
+    for (u64 radix_min : { u64(0), u64(1) << 20 }) {
+        auto vp = VP {};
+        auto vpc = VPC {};
+        vp.settings.radix_min_size = vpc.settings.radix_min_size = radix_min;
+        compact_vector_set_bits(vpc.get_v1(), 12);
+        compact_vector_set_bits(vpc.get_v2(), 17);
+        auto ref = VectorPairsSimple<u32, u32>();
+        for (u32 i = 0; i < 20000; ++i) {
+            u32 a = rng() % 4000, b = rng() & 0x1ffff;
+            vp.emplace_back(a, b);
+            vpc.emplace_back(a, b);
+            ref.emplace_back(a, b);
+        }
+        vp.sort_by_fwd().unique();
+        vpc.sort_by_fwd().unique();
+        ref.sort_by_fwd().unique();
+        assert(std::ranges::equal(vp.fwd_pairs(), ref.fwd_pairs()));
+        assert(std::ranges::equal(vpc.fwd_pairs(), ref.fwd_pairs()));
+        vp.sort_by_rev();
+        vpc.sort_by_rev();
+        ref.sort_by_rev();
+        assert(std::ranges::equal(vp.rev_pairs(), ref.rev_pairs()));
+        assert(std::ranges::equal(vpc.rev_pairs(), ref.rev_pairs()));
+    }
+});
+
+test::define_test("External impl", [] {
+    using VP = VectorPairsExternal<u32, u32>;
+    using fwd_vec = std::vector<std::pair<u32, u32>>;
+    using rev_vec = std::vector<std::pair<u32, u32>>;
+    // 2 pairs per run
+    auto vp = VP({ .mem_budget = 2 * 2 * sizeof(u32) });
+
+    vp.sort_by_fwd();
+    vp.sort_by_rev();
+    vp.unique();
+    assert(vp.size() == 0);
+    assert(vp.fwd_pairs().begin() == std::default_sentinel);
+
+    vp.emplace_back(1, 2);
+    vp.emplace_back(1, 1);
+    vp.emplace_back(0, 3);
+    vp.emplace_back(0, 5);
+    vp.emplace_back(0, 3);
+    assert(vp.size() == 5u);
+    assert(vp.num_runs() == 2u);
+
+    vp.sort_by_fwd();
+    assert(std::ranges::equal(vp.fwd_pairs(), fwd_vec {
+                {0, 3}, {0, 3}, {0, 5}, {1, 1}, {1, 2}}));
+    vp.sort_by_rev();
+    assert(std::ranges::equal(vp.rev_pairs(), rev_vec {
+                {1, 1}, {2, 1}, {3, 0}, {3, 0}, {5, 0}}));
+    vp.unique();
+    assert(vp.size() == 4u);
+    assert(std::ranges::equal(vp.rev_pairs(), rev_vec {
+                {1, 1}, {2, 1}, {3, 0}, {5, 0}}));
+    // re-sorting keeps pairs unique
+    vp.sort_by_fwd();
+    assert(vp.size() == 4u);
+    assert(std::ranges::equal(vp.fwd_pairs(), fwd_vec {
+                {0, 3}, {0, 5}, {1, 1}, {1, 2}}));
+});
+
+test::define_test("External bounded runs", [] {
+    auto ext = VectorPairsExternal<u32, u32>({ .mem_budget = 1000, .max_runs = 3 });
+    auto simple = VectorPairsSimple<u32, u32>();
+    std::mt19937 rng(7);
+    for (u32 i = 0; i < 5000; ++i) {
+        u32 a = rng() % 100, b = rng() % 100;
+        ext.emplace_back(a, b);
+        simple.emplace_back(a, b);
+        assert(ext.num_runs() < 3u);
+    }
+
+    ext.sort_by_fwd();
+    simple.sort_by_fwd();
+    assert(ext.num_runs() < 3u);
+    assert(std::ranges::equal(ext.fwd_pairs(), simple.fwd_pairs()));
+    ext.sort_by_rev().unique();
+    simple.sort_by_rev().unique();
+    assert(ext.num_runs() < 3u);
+    assert(ext.size() == simple.size());
+    assert(std::ranges::equal(ext.rev_pairs(), simple.rev_pairs()));
+    ext.sort_by_fwd();
+    simple.sort_by_fwd();
+    assert(ext.size() == simple.size());
+    assert(std::ranges::equal(ext.fwd_pairs(), simple.fwd_pairs()));
+});
+
+test::define_test("External matches Simple", [] {
+    auto ext = VectorPairsExternal<u32, u32>({ .mem_budget = 1000 });
+    auto simple = VectorPairsSimple<u32, u32>();
+    std::mt19937 rng(42);
+    for (u32 i = 0; i < 5000; ++i) {
+        u32 a = rng() % 100, b = rng() % 100;
+        ext.emplace_back(a, b);
+        simple.emplace_back(a, b);
+    }
+    assert(ext.num_runs() > 1u);
+
+    ext.sort_by_rev().unique();
+    simple.sort_by_rev().unique();
+    assert(ext.size() == simple.size());
+    assert(std::ranges::equal(ext.rev_pairs(), simple.rev_pairs()));
+    ext.sort_by_fwd();
+    simple.sort_by_fwd();
+    assert(ext.size() == simple.size());
+    assert(std::ranges::equal(ext.fwd_pairs(), simple.fwd_pairs()));
+});
+
 });
@@ -0,0 +1,188 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#include "testlib/test.h"
+#include "testlib/tmp_file.h"
+
+#include "triegraph/util/compact_vector.h"
+#include "triegraph/util/vm_vector.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <numeric>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+using namespace triegraph;
+
+static void save(const std::string &path, const auto &v) {
+    BinaryWriter w(path);
+    w.write_pod(u32(42)); // the section still starts aligned
+    v.save(w);
+    w.close();
+}
+
+int m = test::define_module(__FILE__, [] {
+
+test::define_test("empty", [] {
+    VmVector<u32> v;
+    assert(v.size() == 0);
+    assert(v.capacity() == 0);
+    assert(v.reserved_bytes() == 0);
+    assert(v.begin() == v.end());
+});
+
+test::define_test("push_back", [] {
+    VmVector<u64> v;
+    for (u64 i = 0; i < 100000; ++i)
+        v.push_back(i * 3);
+    assert(v.size() == 100000);
+    assert(v.capacity() >= v.size());
+    for (u64 i = 0; i < v.size(); ++i)
+        assert(v[i] == i * 3);
+    assert(v.back() == 99999 * 3);
+});
+
+test::define_test("no copy on growth", [] {
+    VmVector<u32> v;
+    v.push_back(1);
+    auto *beg = v.data();
+    for (u32 i = 0; i < 1000000; ++i)
+        v.push_back(i);
+    assert(v.data() == beg);
+});
+
+test::define_test("grow past reservation", [] {
+    auto saved = VmVector<u32>::default_reserve_bytes();
+    VmVector<u32>::default_reserve_bytes() = 1;
+    VmVector<u32> v;
+    for (u32 i = 0; i < 100000; ++i)
+        v.push_back(i);
+    VmVector<u32>::default_reserve_bytes() = saved;
+    assert(v.reserved_bytes() >= v.size() * sizeof(u32));
+    std::vector<u32> expected(100000);
+    std::iota(expected.begin(), expected.end(), 0);
+    assert(std::ranges::equal(v, expected));
+});
+
+test::define_test("resize and shrink", [] {
+    VmVector<u32> v(10, 7);
+    assert(std::ranges::equal(v, std::vector<u32>(10, 7)));
+    v.resize(100000);
+    assert(v[9] == 7 && v[10] == 0 && v[99999] == 0);
+    v.resize(5);
+    v.shrink_to_fit();
+    assert(v.size() == 5 && v[4] == 7);
+    v.resize(20);
+    assert(v[4] == 7 && v[5] == 0 && v[19] == 0);
+});
+
+test::define_test("copy and move", [] {
+    VmVector<u32> a;
+    for (u32 i = 0; i < 1000; ++i)
+        a.push_back(i);
+    VmVector<u32> b = a;
+    assert(std::ranges::equal(a, b));
+    b[0] = 5;
+    assert(a[0] == 0);
+    VmVector<u32> c = std::move(a);
+    assert(a.size() == 0);
+    assert(std::ranges::equal(c | std::views::drop(1), b | std::views::drop(1)));
+    using std::swap;
+    swap(b, c);
+    assert(b[0] == 0 && c[0] == 5);
+});
+
+test::define_test("compact vector storage", [] {
+    auto cv = CompactVector<u32, VmVector<u32>>().set_bits(13);
+    for (u32 i = 0; i < 50000; ++i)
+        cv.push_back(i * 7);
+    for (u32 i = 0; i < 50000; ++i)
+        assert(cv[i] == (i * 7 & 0x1fff));
+});
+
+test::define_test("load maps the file", [] {
+    auto path = test::tmp_file("vm-map");
+    VmVector<u64> v;
+    for (u64 i = 0; i < 100000; ++i)
+        v.push_back(i * 3);
+    save(path, v);
+
+    VmVector<u64> m;
+    {
+        BinaryReader r(path);
+        assert(r.read_pod<u32>() == 42);
+        m.load(r);
+    }
+    assert(std::ranges::equal(m, v));
+
+    // writes are private, the file is not changed
+    m[0] = 7;
+    VmVector<u64> m2;
+    {
+        BinaryReader r(path);
+        r.read_pod<u32>();
+        m2.load(r);
+    }
+    std::filesystem::remove(path);
+    assert(m2[0] == 0 && m[0] == 7);
+
+    // growth after the mapped part
+    for (u64 i = 0; i < 100000; ++i)
+        m.push_back(i);
+    assert(m.size() == 200000 && m[100000] == 0 && m[199999] == 99999);
+    assert(m[99999] == 99999 * 3);
+});
+
+test::define_test("load grow past reservation", [] {
+    auto path = test::tmp_file("vm-grow");
+    VmVector<u32> v(1000, 5);
+    save(path, v);
+
+    auto saved = VmVector<u32>::default_reserve_bytes();
+    VmVector<u32>::default_reserve_bytes() = 1;
+    VmVector<u32> m;
+    {
+        BinaryReader r(path);
+        r.read_pod<u32>();
+        m.load(r);
+    }
+    std::filesystem::remove(path);
+    for (u32 i = 0; i < 100000; ++i)
+        m.push_back(i);
+    VmVector<u32>::default_reserve_bytes() = saved;
+    assert(m.size() == 101000 && m[999] == 5 && m[1000] == 0 && m[100999] == 99999);
+});
+
+test::define_test("load truncated", [] {
+    auto path = test::tmp_file("vm-trunc");
+    VmVector<u64> v(100000, 3);
+    save(path, v);
+    // the elements start at the first section boundary, keep a page of them
+    std::filesystem::resize_file(path, BINARY_IO_SECTION_ALIGN + 4096);
+    VmVector<u64> m;
+    BinaryReader r(path);
+    r.read_pod<u32>();
+    bool thrown = test::throws_ccp([&] { m.load(r); }, "binary-io-truncated");
+    std::filesystem::remove(path);
+    assert(thrown);
+    assert(m.size() == 0);
+});
+
+test::define_test("load empty", [] {
+    auto path = test::tmp_file("vm-empty");
+    save(path, VmVector<u32> {});
+    VmVector<u32> m(10);
+    BinaryReader r(path);
+    r.read_pod<u32>();
+    m.load(r);
+    std::filesystem::remove(path);
+    assert(m.size() == 0);
+    m.push_back(3);
+    assert(m[0] == 3);
+});
+
+});
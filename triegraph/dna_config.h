@@ -42,6 +42,21 @@ struct CfgFlags {
      * Use DNA representation that supports N letter
      */
     static constexpr u32 USE_DNAN         = 1u << 7;
+    /** Keep VectorPairs in sorted runs on disk, for graphs whose pairs don't
+     * fit in memory. Overrides VP_DUAL_IMPL */
+    static constexpr u32 VP_EXTERNAL      = 1u << 8;
+    /** Store only canonical kmers inside nodes, recovering the reverse
+     * complements from the mirrored node. Needs add_reverse_complement */
+    static constexpr u32 TD_CANONICAL     = 1u << 9;
+    /** Back VectorPairsDual (and its CompactVectors) with VmVector, so
+     * builders append without the copies of vector doubling, and parallel
+     * builders write through a ConcurrentPairsSink. Doesn't work with
+     * TD_ZERO_OVERHEAD, which moves the pair vectors into TrieData */
+    static constexpr u32 VP_VM_VECTOR     = 1u << 10;
+    /** Back the TrieData containers with VmVector, so TrieData::load maps
+     * them from the file, instead of reading them. Doesn't work with
+     * TD_ZERO_OVERHEAD */
+    static constexpr u32 TD_VM_VECTOR     = 1u << 11;
 };
 
 template<u64 trie_depth = 15,
@@ -56,13 +71,18 @@ struct DnaConfig {
     using LetterLoc = std::conditional_t<flags & CfgFlags::WEB_SCALE, u64, u32>;
     using KmerHolder = std::conditional_t<flags & CfgFlags::WEB_SCALE, u64, u32>;
     static constexpr bool triedata_allow_inner = flags & CfgFlags::ALLOW_INNER_KMER;
-    static constexpr VectorPairsImpl vector_pairs_impl = flags & CfgFlags::VP_DUAL_IMPL ?
-        VectorPairsImpl::DUAL : VectorPairsImpl::SIMPLE;
+    static constexpr VectorPairsImpl vector_pairs_impl =
+        flags & CfgFlags::VP_EXTERNAL ? VectorPairsImpl::EXTERNAL :
+        flags & CfgFlags::VP_DUAL_IMPL ? VectorPairsImpl::DUAL :
+        VectorPairsImpl::SIMPLE;
     static constexpr bool trie_pairs_raw = flags & CfgFlags::VP_RAW_KMERS;
     static constexpr u32 TDMapType = 1u; /* use DMM */
     static constexpr bool triedata_sorted_vector = flags & CfgFlags::TD_SORTED_VECTOR;
     static constexpr bool triedata_zero_overhead = flags & CfgFlags::TD_ZERO_OVERHEAD;
+    static constexpr bool triedata_canonical = flags & CfgFlags::TD_CANONICAL;
     static constexpr bool compactvector_for_elems = flags & CfgFlags::CV_ELEMS;
+    static constexpr bool vector_pairs_vm = flags & CfgFlags::VP_VM_VECTOR;
+    static constexpr bool triedata_vm = flags & CfgFlags::TD_VM_VECTOR;
     static constexpr int LetterLocIdxShift = 4;
     static constexpr u64 KmerLen = trie_depth;
     static constexpr KmerHolder on_mask = KmerHolder(1) << (
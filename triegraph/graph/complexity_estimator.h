@@ -143,6 +143,25 @@ struct ComplexityEstimator {
     const std::vector<NodeLoc> &get_ends() const { return end; }
     const std::vector<NodeLoc> &get_starts() const { return start; }
 
+    /**
+     * Per node trie depth: the largest one (but at least min_depth), for which
+     * the kmers ending at the start of the node are estimated to be at most
+     * max_kmers. Every dropped letter divides the estimate by num_options.
+     */
+    std::vector<u32> get_depths(KmerHolder max_kmers, u32 min_depth) const {
+        std::vector<u32> res(graph.num_nodes(), trie_depth);
+        for (NodeLoc nid = 0; nid < graph.num_nodes(); ++nid) {
+            auto est = start[nid];
+            auto &d = res[nid];
+            while (d > min_depth && est > max_kmers) {
+                est = (est + Graph::Str::Letter::num_options - 1) /
+                    Graph::Str::Letter::num_options;
+                --d;
+            }
+        }
+        return res;
+    }
+
 private:
 
     void _add_pq(NodeLoc nid) {
@@ -27,7 +27,12 @@ struct NodePos {
     }
 
     NodePos reverse(auto const& graph) const {
-        return NodePos(node ^ 1, graph.node(node).seg.size() - 1 - pos);
+        return reverse_in(graph.node(node).seg.size());
+    }
+
+    /** reverse, when the node length is known */
+    NodePos reverse_in(NodeLen len) const {
+        return NodePos(node ^ 1, len - 1 - pos);
     }
 };
 
@@ -103,6 +108,11 @@ struct LetterLocData {
         return node_start[handle.node] + handle.pos;
     }
 
+    NodeLen node_len(NodeLoc node) const {
+        return (node + 1 < node_start.size() ? node_start[node + 1] : num_locations) -
+            node_start[node];
+    }
+
     struct NPIterSent {};
     struct NPIter {
         using iterator_category = std::forward_iterator_tag;
@@ -78,6 +78,17 @@ struct RgfaGraph {
     }
 
     NodeLoc num_nodes() const { return data.nodes.size(); }
+    /** nodes before the ones add_extends appended (at the end) */
+    NodeLoc num_original_nodes() const {
+        NodeLoc n = num_nodes();
+        if (settings.add_extends)
+            while (n > 0 && _is_extend(data.nodes[n - 1].seg_id))
+                --n;
+        return n;
+    }
+    static bool _is_extend(const std::string &seg_id) {
+        return seg_id.starts_with("extend:") || seg_id.starts_with("revcomp:extend:");
+    }
     EdgeLoc num_edges() const { return data.edges.size(); }
     const Node &node(NodeLoc id) const { return data.nodes[id]; }
 
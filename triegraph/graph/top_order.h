@@ -6,9 +6,13 @@
 #ifndef __TOP_ORDER_H__
 #define __TOP_ORDER_H__
 
+#include "triegraph/util/util.h"
+
 #include <vector>
 #include <stack>
+#include <queue>
 #include <algorithm>
+#include <bit>
 #include <assert.h>
 
 namespace triegraph {
@@ -41,6 +45,113 @@ struct TopOrder {
 
     Comparator comp() const { return { *this }; }
 
+    /**
+     * Max-priority queue of nodes by top-order index (sources first), with
+     * no duplicates.
+     */
+    struct HeapQueue {
+        std::priority_queue<NodeLoc, std::vector<NodeLoc>, Comparator> q;
+        std::vector<bool> in_q;
+
+        HeapQueue(const TopOrder &top_ord)
+            : q(top_ord.comp()), in_q(top_ord.idx.size(), false) {}
+
+        bool empty() const { return q.empty(); }
+        void push(NodeLoc node) {
+            if (!in_q[node]) {
+                in_q[node] = true;
+                q.push(node);
+            }
+        }
+        NodeLoc pop() {
+            auto node = q.top(); q.pop();
+            in_q[node] = false;
+            return node;
+        }
+    };
+
+    /**
+     * Same as HeapQueue, but for (mostly) monotone use: after a node is
+     * popped, the pushed nodes tend to come later in the order.
+     *
+     * Nodes are kept in a bitset by index, and the top is found by scanning
+     * down from the last pop. Pushes above that point (over back-edges) go to
+     * a small heap instead.
+     */
+    struct Queue {
+        const TopOrder &top_ord;
+        std::vector<NodeLoc> by_idx;
+        std::vector<u64> bits;
+        u64 limit; // bits at limit and above are 0
+        std::priority_queue<NodeLoc, std::vector<NodeLoc>, Comparator> late;
+        std::vector<bool> in_late;
+        u64 sz;
+
+        Queue(const TopOrder &top_ord)
+            : top_ord(top_ord),
+              by_idx(top_ord.idx.size()),
+              bits(div_up(top_ord.idx.size(), 64u), 0),
+              limit(top_ord.idx.size()),
+              late(top_ord.comp()),
+              in_late(top_ord.idx.size(), false),
+              sz(0)
+        {
+            for (NodeLoc i = 0; i < top_ord.idx.size(); ++i)
+                by_idx[top_ord.idx[i]] = i;
+        }
+
+        bool empty() const { return sz == 0; }
+
+        void push(NodeLoc node) {
+            u64 i = top_ord.idx[node];
+            if (in_late[node])
+                return;
+            if (i < limit) {
+                u64 &w = bits[i >> 6];
+                u64 m = u64(1) << (i & 63);
+                if (w & m)
+                    return;
+                w |= m;
+            } else {
+                in_late[node] = true;
+                late.push(node);
+            }
+            ++sz;
+        }
+
+        NodeLoc pop() {
+            --sz;
+            u64 i = _scan();
+            if (!late.empty() && (i == INV || top_ord.idx[late.top()] > i)) {
+                auto node = late.top(); late.pop();
+                in_late[node] = false;
+                limit = top_ord.idx[node] + 1;
+                return node;
+            }
+            bits[i >> 6] &= ~(u64(1) << (i & 63));
+            limit = i + 1;
+            return by_idx[i];
+        }
+
+    private:
+        static constexpr u64 INV = ~u64(0);
+
+        // highest set bit below limit, lowering limit over empty words
+        u64 _scan() {
+            while (limit > 0) {
+                u64 wi = (limit - 1) >> 6;
+                u64 w = bits[wi];
+                u64 off = (limit - 1) & 63;
+                if (off != 63)
+                    w &= (u64(1) << (off + 1)) - 1;
+                if (w)
+                    return wi * 64 + 63 - std::countl_zero(w);
+                limit = wi * 64;
+            }
+            return INV;
+        }
+    };
+
     std::vector<NodeLoc> get_ordered_nodes() const {
         std::vector<NodeLoc> res(idx.size());
         for (NodeLoc i = 0; i < idx.size(); ++i) {
@@ -16,10 +16,14 @@
 #include "triegraph/graph/complexity_component.h"
 #include "triegraph/graph/complexity_component_walker.h"
 #include "triegraph/triegraph/handle.h"
+#include "triegraph/trie/canonical_kmers.h"
 #include "triegraph/trie/kmer_settings.h"
+#include "triegraph/trie/sampled_lookup.h"
 #include "triegraph/trie/builder/bt.h"
 #include "triegraph/trie/builder/lbfs.h"
+#include "triegraph/trie/builder/lbfs_par.h"
 #include "triegraph/trie/builder/nbfs.h"
+#include "triegraph/trie/builder/nbfs_par.h"
 #include "triegraph/trie/builder/pbfs.h"
 #include "triegraph/triegraph/triegraph_data.h"
 #include "triegraph/triegraph/triegraph_edge_iter.h"
@@ -28,17 +32,31 @@
 #include "triegraph/trie/kmer.h"
 #include "triegraph/trie/dkmer.h"
 #include "triegraph/trie/trie_data.h"
+#include "triegraph/trie/trie_data_retarget.h"
+#include "triegraph/trie/trie_data_updater.h"
+#include "triegraph/util/checkpoint.h"
 #include "triegraph/util/compact_vector.h"
+#include "triegraph/util/concurrent_pairs_sink.h"
+#include "triegraph/util/dedup_pairs_filter.h"
+#include "triegraph/util/pairs_generator.h"
 #include "triegraph/util/dense_multimap.h"
 #include "triegraph/util/hybrid_multimap.h"
 #include "triegraph/util/simple_multimap.h"
 #include "triegraph/util/sorted_vector.h"
 #include "triegraph/util/util.h"
 #include "triegraph/util/vector_pairs.h"
+#include "triegraph/util/vector_pairs_external.h"
 #include "triegraph/util/vector_pairs_inserter.h"
+#include "triegraph/util/vm_vector.h"
 #include "triegraph/util/logger.h"
 
+#include <algorithm>
+#include <bit>
+#include <ranges>
+#include <string>
+#include <string_view>
 #include <type_traits>
+#include <typeinfo>
 #include <vector>
 
 namespace triegraph {
@@ -99,38 +117,49 @@ struct Manager : Cfg {
     using G2TSMM = SimpleMultimap<
         typename Cfg::LetterLoc,
         typename Cfg::KmerHolder>;
+    template <typename T>
+    using TDStorage_ = std::conditional_t<Cfg::triedata_vm,
+          VmVector<T>,
+          std::vector<T> >;
     using StartsContainer = std::conditional_t<
         Cfg::triedata_sorted_vector,
-        SortedVector<typename Cfg::KmerHolder>,
-        std::vector<typename Cfg::KmerHolder>>;
+        SortedVector<typename Cfg::KmerHolder, u8, TDStorage_>,
+        TDStorage_<typename Cfg::KmerHolder>>;
     using T2GDMM = DenseMultimap<
         typename Cfg::KmerHolder,
         typename Cfg::LetterLoc,
         StartsContainer,
         std::conditional_t<Cfg::compactvector_for_elems,
-            CompactVector<typename Cfg::LetterLoc>,
-            std::vector<typename Cfg::LetterLoc> > >;
+            CompactVector<typename Cfg::LetterLoc, TDStorage_<typename Cfg::LetterLoc> >,
+            TDStorage_<typename Cfg::LetterLoc> > >;
     using G2TDMM = DenseMultimap<
         typename Cfg::LetterLoc,
         typename Cfg::KmerHolder,
         StartsContainer,
         std::conditional_t<Cfg::compactvector_for_elems,
-            CompactVector<typename Cfg::KmerHolder>,
-            std::vector<typename Cfg::KmerHolder> > >;
+            CompactVector<typename Cfg::KmerHolder, TDStorage_<typename Cfg::KmerHolder> >,
+            TDStorage_<typename Cfg::KmerHolder> > >;
     using T2GMap = choose_type_t<Cfg::TDMapType, T2GSMM, T2GDMM>;
     using G2TMap = choose_type_t<Cfg::TDMapType, G2TSMM, G2TDMM>;
     // using VectorPairs = std::vector<std::pair<Kmer, typename LetterLocData::LetterLoc>>;
     using VPFirst_ = std::conditional_t<Cfg::trie_pairs_raw, Kmer, typename Cfg::KmerHolder>;
     using VPSecond_ = LetterLocData::LetterLoc;
+    template <typename T>
+    using VPStorage_ = std::conditional_t<Cfg::vector_pairs_vm,
+          VmVector<T>,
+          std::vector<T> >;
     using VectorPairs = choose_type_t<
         u32(Cfg::vector_pairs_impl),
         triegraph::VectorPairsEmpty<VPFirst_, VPSecond_>,
         triegraph::VectorPairsSimple<VPFirst_, VPSecond_>,
         std::conditional_t<Cfg::compactvector_for_elems,
             triegraph::VectorPairsDual<VPFirst_, VPSecond_,
-                CompactVector<VPFirst_>,
-                CompactVector<VPSecond_> >,
-            triegraph::VectorPairsDual<VPFirst_, VPSecond_> > >;
+                CompactVector<VPFirst_, VPStorage_<VPFirst_> >,
+                CompactVector<VPSecond_, VPStorage_<VPSecond_> > >,
+            triegraph::VectorPairsDual<VPFirst_, VPSecond_,
+                VPStorage_<VPFirst_>,
+                VPStorage_<VPSecond_> > >,
+        triegraph::VectorPairsExternal<VPFirst_, VPSecond_> >;
     static constexpr auto vp_inserter_fmap = [](auto &&k) {
         return KmerCodec::to_int(std::forward<decltype(k)>(k));
     };
@@ -139,29 +168,86 @@ struct Manager : Cfg {
         decltype(vp_inserter_fmap),
         std::identity,
         std::pair<Kmer, typename LetterLocData::LetterLoc>>;
-    using VPAlgo = std::conditional_t<
+    using VPSink = std::conditional_t<
         Cfg::trie_pairs_raw,
         VectorPairs,
         VectorPairsInserter>;
+    // what builders write into: VPAlgo, writing into Pairs instead of
+    // VectorPairs
+    template <typename Pairs>
+    using VPSinkFor_ = std::conditional_t<
+        Cfg::trie_pairs_raw,
+        Pairs,
+        triegraph::VectorPairsInserter<
+            Pairs,
+            decltype(vp_inserter_fmap),
+            std::identity,
+            std::pair<Kmer, typename LetterLocData::LetterLoc>>>;
+    template <typename Pairs>
+    using VPDedupFor_ = triegraph::DedupPairsFilter<
+        VPSinkFor_<Pairs>, Kmer, typename LetterLocData::LetterLoc>;
+    template <typename Pairs>
+    using VPAlgoFor_ = std::conditional_t<
+        Cfg::triedata_canonical,
+        CanonicalPairsFilter<VPDedupFor_<Pairs>, Kmer, LetterLocData>,
+        VPDedupFor_<Pairs>>;
+    using VPAlgo = VPAlgoFor_<VectorPairs>;
+    // builders writing from many threads get a ConcurrentPairsSink (Dual
+    // VmVector pairs only, others would be copied out of the sink's
+    // VmVectors in the end)
+    using ConcurrentPairs = triegraph::ConcurrentPairsSink<VectorPairs>;
+    using VPAlgoPar = std::conditional_t<
+        Cfg::vector_pairs_impl != VectorPairsImpl::DUAL || !Cfg::vector_pairs_vm,
+        VPAlgo,
+        VPAlgoFor_<ConcurrentPairs>>;
+    // pairs_generator builders write into a PairsChannelSink
+    using GeneratorPairs = triegraph::PairsChannelSink<
+        typename VectorPairs::T1, typename VectorPairs::T2>;
+    using VPAlgoGen = VPAlgoFor_<GeneratorPairs>;
     using TrieData = triegraph::TrieData<
         Kmer,
         LetterLocData,
         VectorPairs,
         Cfg::triedata_allow_inner,
         T2GMap, G2TMap,
-        Cfg::triedata_zero_overhead>;
+        Cfg::triedata_zero_overhead,
+        Cfg::triedata_canonical>;
+    using TrieDataUpdater = triegraph::TrieDataUpdater<
+        Graph, LetterLocData, TrieData>;
+    using TrieDataRetarget = triegraph::TrieDataRetarget<
+        Graph, LetterLocData, TrieData>;
+    using SampledLookup = triegraph::SampledLookup<
+        Graph, LetterLocData, TrieData>;
     using TrieGraphData = triegraph::TrieGraphData<
         Graph,
         LetterLocData,
         TrieData>;
     using TrieBuilderLBFS = triegraph::TrieBuilderLBFS<
         Graph, LetterLocData, Kmer, VPAlgo>;
+    using TrieBuilderLBFSPar = triegraph::TrieBuilderLBFSPar<
+        Graph, LetterLocData, Kmer, VPAlgo>;
     using TrieBuilderBT = triegraph::TrieBuilderBT<
         Graph, LetterLocData, Kmer, VPAlgo>;
     using TrieBuilderPBFS = triegraph::TrieBuilderPBFS<
         Graph, LetterLocData, Kmer, VPAlgo>;
     using TrieBuilderNBFS = triegraph::TrieBuilderNBFS<
         Graph, LetterLocData, Kmer, VPAlgo>;
+    using TrieBuilderNBFSPar = triegraph::TrieBuilderNBFSPar<
+        Graph, LetterLocData, Kmer, VPAlgoPar>;
+
+    // TrieBuilder, writing into Pairs instead
+    template <typename TrieBuilder, typename Pairs>
+    struct TrieBuilderFor_;
+    template <template <typename, typename, typename, typename> typename TB,
+             typename G, typename L, typename K, typename P, typename Pairs>
+    struct TrieBuilderFor_<TB<G, L, K, P>, Pairs> {
+        using type = TB<G, L, K, Pairs>;
+    };
+    template <typename TrieBuilder>
+    using TrieBuilderGen_ = TrieBuilderFor_<TrieBuilder, VPAlgoGen>::type;
+    template <typename TrieBuilder>
+    using TrieBuilderCounting_ = TrieBuilderFor_<TrieBuilder,
+          VPAlgoFor_<typename TrieData::CountingSink>>::type;
 
     using Handle = triegraph::Handle<Kmer, NodePos>;
     using EditEdge = triegraph::EditEdge<Handle>;
@@ -172,9 +258,11 @@ struct Manager : Cfg {
     using TrieGraph = triegraph::TrieGraph<
         TrieGraphData>;
 
-    enum struct Algo { LOCATION_BFS, BACK_TRACK, POINT_BFS, NODE_BFS, UNKNOWN };
-    static constexpr std::array<Algo, 4> algorithms = {
-        Algo::LOCATION_BFS, Algo::BACK_TRACK, Algo::POINT_BFS, Algo::NODE_BFS };
+    enum struct Algo { LOCATION_BFS, BACK_TRACK, POINT_BFS, NODE_BFS,
+        NODE_BFS_PAR, LOCATION_BFS_PAR, UNKNOWN };
+    static constexpr std::array<Algo, 6> algorithms = {
+        Algo::LOCATION_BFS, Algo::BACK_TRACK, Algo::POINT_BFS, Algo::NODE_BFS,
+        Algo::NODE_BFS_PAR, Algo::LOCATION_BFS_PAR };
 
     static constexpr const char *algo_name(Algo algo) {
         switch (algo) {
@@ -182,6 +270,8 @@ struct Manager : Cfg {
             case Algo::BACK_TRACK: return "BACK_TRACK";
             case Algo::POINT_BFS: return "POINT_BFS";
             case Algo::NODE_BFS: return "NODE_BFS";
+            case Algo::NODE_BFS_PAR: return "NODE_BFS_PAR";
+            case Algo::LOCATION_BFS_PAR: return "LOCATION_BFS_PAR";
             default: return "";
         }
     }
@@ -196,6 +286,10 @@ struct Manager : Cfg {
             return Algo::POINT_BFS;
         if (lname == "node_bfs" || lname == "nbfs")
             return Algo::NODE_BFS;
+        if (lname == "node_bfs_par" || lname == "nbfs_par")
+            return Algo::NODE_BFS_PAR;
+        if (lname == "bfs_par" || lname == "lbfs_par")
+            return Algo::LOCATION_BFS_PAR;
         return Algo::UNKNOWN;
     }
 
@@ -207,14 +301,18 @@ struct Manager : Cfg {
     struct PairsVariantRaw {};
     struct PairsVariantCompressed {};
 
-    static VectorPairs &make_pairs_inserter(VectorPairs &pairs, PairsVariantRaw) {
-        // std::cerr << "returning same" << std::endl;
+    template <typename Pairs>
+    static Pairs &make_pairs_inserter(Pairs &pairs, PairsVariantRaw) {
         return pairs;
     }
-    static auto make_pairs_inserter(
-            VectorPairs &pairs, PairsVariantCompressed) {
-        // std::cerr << "NOT returning same" << std::endl;
-        return VectorPairsInserter(pairs, vp_inserter_fmap, {});
+    template <typename Pairs>
+    static auto make_pairs_inserter(Pairs &pairs, PairsVariantCompressed) {
+        return triegraph::VectorPairsInserter<
+            Pairs,
+            decltype(vp_inserter_fmap),
+            std::identity,
+            std::pair<Kmer, typename LetterLocData::LetterLoc>>(
+                    pairs, vp_inserter_fmap, {});
     }
 
     template <typename TrieBuilder,
@@ -228,34 +326,211 @@ struct Manager : Cfg {
             KmerSettings kmer_settings,
             TrieBuilder::Settings tb_settings,
             std::ranges::input_range auto&& starts) {
-        // std::cerr << "FOOOOOO" << std::endl;
         Kmer::set_settings(kmer_settings);
         auto pairs = VectorPairs {};
         _vp_set_bits(pairs, lloc);
-        std::conditional_t<Cfg::trie_pairs_raw,
-            VectorPairs &,
-            VectorPairsInserter> pairs_inserter = make_pairs_inserter(pairs, pairs_variant {});
-        // pairs.emplace_back(Kmer::empty(), 0);
-        // assert(pairs.size() == 1);
-        // assert(pairs_inserter.size() == 1);
-        // std::cerr << "&pairs " << &pairs << " " << "&pi " << &pairs_inserter << std::endl;
-        TrieBuilder(graph, lloc, pairs_inserter)
-            .set_settings(std::move(tb_settings))
-            .compute_pairs(std::forward<decltype(starts)>(starts));
-        // std::cerr << "got pairs size " << pairs.size() << std::endl;
+        if constexpr (concurrent_pairs_sink_v<typename TrieBuilder::VectorPairs>) {
+            ConcurrentPairs sink(std::move(pairs));
+            _run_builder<TrieBuilder, pairs_variant>(graph, lloc, sink,
+                    std::move(tb_settings), std::forward<decltype(starts)>(starts));
+            pairs = sink.take();
+        } else {
+            _run_builder<TrieBuilder, pairs_variant>(graph, lloc, pairs,
+                    std::move(tb_settings), std::forward<decltype(starts)>(starts));
+        }
         _vp_check_bits(pairs);
         return pairs;
     }
 
+    /**
+     * Like graph_to_pairs, but the pairs are produced lazily, while the
+     * builder runs (in a separate thread), so consumers that don't need all
+     * pairs at once (counting, statistics, external sort runs) never hold
+     * them all. Pairs come in the order the builder emits them.
+     *
+     * graph, lloc and (lvalue) starts must outlive the generator.
+     */
+    template <typename TrieBuilder,
+             typename pairs_variant = std::conditional_t<
+                 Cfg::trie_pairs_raw,
+                 PairsVariantRaw,
+                 PairsVariantCompressed>>
+    static auto pairs_generator(
+            const Graph &graph,
+            const LetterLocData &lloc,
+            KmerSettings kmer_settings,
+            TrieBuilderGen_<TrieBuilder>::Settings tb_settings,
+            std::ranges::input_range auto&& starts) {
+        Kmer::set_settings(kmer_settings);
+        return triegraph::pairs_generator<
+            typename VectorPairs::T1, typename VectorPairs::T2>(
+                [&graph, &lloc, tb_settings = std::move(tb_settings),
+                 starts = std::views::all(std::forward<decltype(starts)>(starts))]
+                (GeneratorPairs &sink) mutable {
+                    _run_builder<TrieBuilderGen_<TrieBuilder>, pairs_variant>(
+                            graph, lloc, sink, std::move(tb_settings), starts);
+                });
+    }
+
+    template <typename TrieBuilder, typename pairs_variant>
+    static void _run_builder(
+            const Graph &graph,
+            const LetterLocData &lloc,
+            auto &target,
+            TrieBuilder::Settings &&tb_settings,
+            std::ranges::input_range auto&& starts,
+            DedupPairsSettings dedup_settings = DedupPairsSettings::default_settings()) {
+        auto &&pairs_inserter = make_pairs_inserter(target, pairs_variant {});
+        auto dedup = triegraph::DedupPairsFilter<
+            std::remove_reference_t<decltype(pairs_inserter)>,
+            Kmer, typename LetterLocData::LetterLoc>(pairs_inserter, dedup_settings);
+        if constexpr (Cfg::triedata_canonical) {
+            if (!graph.settings.add_reverse_complement)
+                throw "canonical-kmers-need-reverse-complement";
+            auto filter = CanonicalPairsFilter<
+                decltype(dedup), Kmer, LetterLocData>(dedup, lloc);
+            TrieBuilder(graph, lloc, filter)
+                .set_settings(std::move(tb_settings))
+                .compute_pairs(std::forward<decltype(starts)>(starts));
+        } else {
+            TrieBuilder(graph, lloc, dedup)
+                .set_settings(std::move(tb_settings))
+                .compute_pairs(std::forward<decltype(starts)>(starts));
+        }
+        if (dedup.enabled()) {
+            auto stats = dedup.stats();
+            Logger::get().log("pairs dedup",
+                    "; seen =", stats.seen,
+                    "; dropped =", stats.dropped,
+                    "; ratio =", stats.ratio());
+        }
+    }
+
+    /**
+     * Pairs only for kmers starting at SparseStarts every N positions (for
+     * sampled TrieData, queried with SampledLookup). Needs a builder that
+     * honours starts (PBFS, BT). Not for canonical TrieData, which would drop
+     * the pairs whose mirror start isn't sampled.
+     */
+    template <typename TrieBuilder,
+             typename pairs_variant = std::conditional_t<
+                 Cfg::trie_pairs_raw,
+                 PairsVariantRaw,
+                 PairsVariantCompressed>>
+    static VectorPairs graph_to_sampled_pairs(
+            const Graph &graph,
+            const LetterLocData &lloc,
+            KmerSettings kmer_settings,
+            TrieBuilder::Settings tb_settings,
+            typename Cfg::NodeLoc every) {
+        static_assert(!Cfg::triedata_canonical);
+        auto ss = SparseStarts(graph);
+        auto starts = ss.compute_starts_every(
+                every, ConnectedComponents(graph).compute_starting_points());
+        return graph_to_pairs<TrieBuilder, pairs_variant>(
+                graph, lloc, std::move(kmer_settings), std::move(tb_settings),
+                starts);
+    }
+
+    struct PairRec {
+        VPFirst_ first;
+        VPSecond_ second;
+    };
+    static constexpr u64 PAIRS_CHUNK = u64(1) << 16;
+
+    // order, then chunks of (size, pairs), terminated by an empty chunk
+    static void _save_pairs(const Checkpoint &cp, const std::string &stage,
+            const VectorPairs &pairs) {
+        static_assert(std::is_trivially_copyable_v<PairRec>);
+        cp.save(stage, [&pairs](BinaryWriter &w) {
+            std::vector<PairRec> buf;
+            buf.reserve(PAIRS_CHUNK);
+            auto flush = [&w, &buf]() {
+                w.write_pod(u64(buf.size()));
+                w.write(buf.data(), buf.size() * sizeof(PairRec));
+                buf.clear();
+            };
+
+            w.write_pod(pairs.get_order());
+            for (const auto &p : pairs.fwd_pairs()) {
+                buf.push_back({ p.first, p.second });
+                if (buf.size() == PAIRS_CHUNK)
+                    flush();
+            }
+            if (!buf.empty())
+                flush();
+            flush();
+        });
+    }
+
+    static bool _load_pairs(const Checkpoint &cp, const std::string &stage,
+            VectorPairs &pairs, const LetterLocData &lloc) {
+        return cp.load(stage, [&pairs, &lloc](BinaryReader &r) {
+            pairs = VectorPairs {};
+            _vp_set_bits(pairs, lloc);
+
+            auto order = r.read_pod<VectorPairsOrder>();
+            std::vector<PairRec> buf;
+            while (u64 n = r.read_pod<u64>()) {
+                buf.resize(n);
+                r.read(buf.data(), n * sizeof(PairRec));
+                for (const auto &p : buf)
+                    pairs.emplace_back(p.first, p.second);
+            }
+            pairs.set_order(order);
+            _vp_check_bits(pairs);
+        });
+    }
+
+    template <typename TrieBuilder>
+    static u64 _fingerprint(const Graph &graph, const LetterLocData &lloc,
+            const auto &cfg) {
+        u64 h = 0;
+        h = hash_combine(h, graph.num_nodes());
+        h = hash_combine(h, graph.num_edges());
+        h = hash_combine(h, lloc.num_locations);
+        for (typename Cfg::NodeLoc i = 0; i < graph.num_nodes(); ++i) {
+            const auto &seg = graph.node(i).seg;
+            using Seg = std::remove_cvref_t<decltype(seg)>;
+            h = hash_combine(h, std::hash<std::string>{}(graph.node(i).seg_id));
+            h = hash_combine(h, seg.size());
+            // the letters, a packed word at a time (bits past the end masked)
+            for (u64 w = 0; w * Seg::letters_per_store < seg.size(); ++w) {
+                auto word = seg.data[w];
+                u64 used = seg.size() - w * Seg::letters_per_store;
+                if (used < u64(Seg::letters_per_store))
+                    word &= (typename Seg::Holder(1) << used * Seg::Letter::bits) - 1;
+                h = hash_combine(h, u64(word));
+            }
+        }
+        h = hash_combine(h, Kmer::K);
+        h = hash_combine(h, Kmer::ON_MASK);
+        h = hash_combine(h, std::hash<std::string_view>{}(typeid(TrieBuilder).name()));
+        h = hash_combine(h, std::hash<std::string_view>{}(typeid(VectorPairs).name()));
+        // builder settings come from the config
+        if constexpr (requires { cfg.flags; }) {
+            for (const auto &[k, v] : cfg.flags) {
+                if (k.starts_with("checkpoint-"))
+                    continue;
+                h = hash_combine(h, std::hash<std::string>{}(k));
+                h = hash_combine(h, std::hash<std::string>{}(v));
+            }
+        }
+        return h;
+    }
+
     static void _vp_set_bits(VectorPairs &pairs, const LetterLocData &lloc) {
         if constexpr (VectorPairs::impl == VectorPairsImpl::DUAL) {
-            // TODO: Put this in CompactVectorSettings, and add cfg override
-            u32 kmer_bits = log2_ceil(TrieData::total_kmers());
-            u32 lloc_bits = log2_ceil(lloc.num_locations);
-            u32 bits = std::max(kmer_bits, lloc_bits) + 1;
+            // tight widths, CompactVectors widen if a value doesn't fit
+            // bits for values in [0, n)
+            auto width = [](u64 n) { return u32(std::max<u64>(1, std::bit_width(n - (n > 0)))); };
+            u32 kmer_bits = width(TrieData::total_kmers());
+            u32 lloc_bits = width(lloc.num_locations);
 
-            compact_vector_set_bits(pairs.get_v1(), bits);
-            compact_vector_set_bits(pairs.get_v2(), bits);
+            compact_vector_set_bits(pairs.get_v1(), kmer_bits);
+            compact_vector_set_bits(pairs.get_v2(), lloc_bits);
+            compact_vector_set_auto_widen(pairs.get_v1(), true);
+            compact_vector_set_auto_widen(pairs.get_v2(), true);
 
             u32 reg_bits = sizeof(typename std::decay_t<
                     decltype(pairs.get_v1())>::value_type) *
@@ -263,7 +538,7 @@ struct Manager : Cfg {
             u32 act_bits = compact_vector_get_bits(pairs.get_v1());
             if (act_bits < reg_bits) {
                 Logger::get().log("activated CompactVector",
-                        "; bits =", act_bits,
+                        "; bits =", act_bits, compact_vector_get_bits(pairs.get_v2()),
                         "; tot =", reg_bits,
                         "; saving =", double(reg_bits - act_bits) / reg_bits);
             }
@@ -272,12 +547,11 @@ struct Manager : Cfg {
 
     static void _vp_check_bits(VectorPairs &pairs) {
         if constexpr (VectorPairs::impl == VectorPairsImpl::DUAL) {
-            u32 pair_bits = log2_ceil(pairs.size());
-            if (pair_bits > compact_vector_get_bits(pairs.get_v1()) ||
-                    pair_bits > compact_vector_get_bits(pairs.get_v2())) {
-                // TODO: Support increasing #bits in CV
-                throw "not-enough-bits-for-pairs";
-            }
+            // pair indices are stored in the columns by the zero overhead
+            // TrieData init
+            u32 pair_bits = std::bit_width(u64(pairs.size()));
+            compact_vector_widen(pairs.get_v1(), pair_bits);
+            compact_vector_widen(pairs.get_v2(), pair_bits);
         }
     }
 
@@ -287,6 +561,10 @@ struct Manager : Cfg {
             const Graph &graph,
             const auto &cfg) {
         auto lloc = LetterLocData(graph);
+        if constexpr (VectorPairs::impl == VectorPairsImpl::EXTERNAL ||
+                VectorPairs::impl == VectorPairsImpl::DUAL)
+            VectorPairs::set_default_settings(VectorPairs::Settings::from_config(cfg));
+        DedupPairsSettings::default_settings() = DedupPairsSettings::from_config(cfg);
         return graph_to_pairs<TrieBuilder, pairs_variant>(
                 graph,
                 lloc,
@@ -302,6 +580,106 @@ struct Manager : Cfg {
         return TrieData(std::move(pairs), lloc);
     }
 
+    /**
+     * The whole graph -> pairs -> sorted pairs -> TrieData pipeline.
+     *
+     * With checkpoint-dir set, pairs are saved after the builder and again
+     * after sorting. A rerun with the same graph and config resumes from the
+     * last saved stage.
+     *
+     * With trie-data-counting-build set (dense maps only), the builder runs
+     * twice instead, see graph_to_triedata_counting (no checkpoints).
+     */
+    template <typename TrieBuilder, typename pairs_variant =
+        std::conditional_t<Cfg::trie_pairs_raw, PairsVariantRaw, PairsVariantCompressed> >
+    static TrieData graph_to_triedata(
+            const Graph &graph,
+            const LetterLocData &lloc,
+            const auto &cfg) {
+        auto ks = KmerSettings::from_seed_config<typename Cfg::KmerHolder>(
+                lloc.num_locations, cfg);
+        Kmer::set_settings(ks);
+        if constexpr (VectorPairs::impl == VectorPairsImpl::EXTERNAL ||
+                VectorPairs::impl == VectorPairsImpl::DUAL)
+            VectorPairs::set_default_settings(VectorPairs::Settings::from_config(cfg));
+        DedupPairsSettings::default_settings() = DedupPairsSettings::from_config(cfg);
+        if constexpr (T2GMap::impl == MultimapImpl::DENSE &&
+                G2TMap::impl == MultimapImpl::DENSE) {
+            if (cfg.template get_or<bool>("trie-data-counting-build", false))
+                return graph_to_triedata_counting<TrieBuilder, pairs_variant>(
+                        graph, lloc, ks,
+                        TrieBuilderCounting_<TrieBuilder>::Settings::from_config(cfg),
+                        lloc);
+        }
+        auto cp = Checkpoint(Checkpoint::Settings::from_config(cfg),
+                _fingerprint<TrieBuilder>(graph, lloc, cfg));
+
+        auto pairs = VectorPairs {};
+        if (!_load_pairs(cp, "sorted-pairs", pairs, lloc)) {
+            if (!_load_pairs(cp, "pairs", pairs, lloc)) {
+                pairs = graph_to_pairs<TrieBuilder, pairs_variant>(
+                        graph, lloc, ks,
+                        TrieBuilder::Settings::from_config(cfg),
+                        lloc);
+                _save_pairs(cp, "pairs", pairs);
+            }
+            {
+                auto scope = Logger::get().begin_scoped("sort by rev + unique");
+                pairs.sort_by_rev().unique();
+            }
+            _save_pairs(cp, "sorted-pairs", pairs);
+            cp.remove("pairs");
+        }
+        return pairs_to_triedata(std::move(pairs), lloc);
+    }
+
+    /**
+     * TrieData built with a counting sort (see TrieData::counting_build): the
+     * builder runs twice, and the pairs are never stored unsorted, nor
+     * sorted. starts are traversed once per run.
+     */
+    template <typename TrieBuilder, typename pairs_variant =
+        std::conditional_t<Cfg::trie_pairs_raw, PairsVariantRaw, PairsVariantCompressed> >
+    static TrieData graph_to_triedata_counting(
+            const Graph &graph,
+            const LetterLocData &lloc,
+            KmerSettings kmer_settings,
+            TrieBuilderCounting_<TrieBuilder>::Settings tb_settings,
+            std::ranges::forward_range auto&& starts) {
+        using Builder = TrieBuilderCounting_<TrieBuilder>;
+        Kmer::set_settings(kmer_settings);
+        return TrieData::counting_build(
+                [&graph, &lloc, &tb_settings, &starts](
+                    typename TrieData::CountingSink &sink) {
+                    // both runs must emit the same pairs, which dedup
+                    // doesn't guarantee for parallel builders
+                    _run_builder<Builder, pairs_variant>(graph, lloc, sink,
+                            typename Builder::Settings(tb_settings), starts,
+                            DedupPairsSettings {});
+                }, lloc);
+    }
+
+    static TrieData update_triedata(
+            TrieData &&td,
+            const Graph &old_graph,
+            const LetterLocData &old_lloc,
+            const Graph &graph,
+            const LetterLocData &lloc,
+            std::ranges::input_range auto &&edited_nodes) {
+        return TrieDataUpdater(graph, lloc).update(
+                std::move(td), old_graph, old_lloc,
+                std::forward<decltype(edited_nodes)>(edited_nodes));
+    }
+
+    /** TrieData for another trie depth, derived one letter at a time */
+    static TrieData retarget_triedata(
+            TrieData &&td,
+            const Graph &graph,
+            const LetterLocData &lloc,
+            u16 trie_depth) {
+        return TrieDataRetarget(graph, lloc).retarget(std::move(td), trie_depth);
+    }
+
     static TrieGraph triedata_to_triegraph(
             TrieData &&td,
             Graph &&g,
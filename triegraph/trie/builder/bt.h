@@ -6,6 +6,7 @@
 #ifndef __TRIE_BUILDER_BT_H__
 #define __TRIE_BUILDER_BT_H__
 
+#include "triegraph/trie/kmer_roller.h"
 #include "triegraph/util/logger.h"
 
 #include <chrono>
@@ -73,16 +74,14 @@ struct TrieBuilderBT {
             typename Kmer::klen_type left_in_kmer = Kmer::K - this->kmer.size();
             if (left_in_kmer < left_in_node) {
                 Kmer tmp = this->kmer;
-                std::ranges::copy(
-                        this->graph.node(np.node).seg.get_view(np.pos, left_in_kmer),
-                        std::back_inserter(tmp));
+                KmerRoller<Kmer>::append(tmp, this->graph.node(np.node).seg,
+                        np.pos, left_in_kmer);
                 pairs.emplace_back(tmp, this->lloc.compress(
                             NodePos(np.node, np.pos + left_in_kmer)));
             } else {
                 Kmer tmp = this->kmer;
-                std::ranges::copy(
-                        this->graph.node(np.node).seg.get_view(np.pos, left_in_node - 1),
-                        std::back_inserter(this->kmer));
+                KmerRoller<Kmer>::append(this->kmer, this->graph.node(np.node).seg,
+                        np.pos, left_in_node - 1);
                 _back_track(NodePos(np.node, np.pos + left_in_node - 1));
                 this->kmer = tmp;
             }
@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TRIE_BUILDER_KMER_BUILD_DATA_H__
+#define __TRIE_BUILDER_KMER_BUILD_DATA_H__
+
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Per-key (graph node or letter location) list of kmers, used by the BFS
+ * builders to track which kmers reached a key, and how many of them were
+ * already propagated (done_idx).
+ *
+ * All lists live in a chunked arena. A list has a power-of-two capacity,
+ * when it outgrows it, it is moved to a bigger block, and the old one goes
+ * into a free list for its size class. A key costs 16 bytes until it gets a
+ * kmer. Lists of set_cutoff or more kmers additionally get an
+ * open-addressing set (in a side map), for faster exists().
+ *
+ * Thread safety: operations on different keys may run concurrently. Calls
+ * for the same key need external synchronization (a StripedLock by key).
+ */
+template <typename Kmer_, typename Key_>
+struct KmerBuildData {
+    using Kmer = Kmer_;
+    using Key = Key_;
+    using Len = u32;
+
+    static constexpr u32 default_set_cutoff = 500u;
+
+    explicit KmerBuildData(u64 num_keys, u32 set_cutoff = default_set_cutoff)
+        : entries(num_keys),
+          set_cutoff(std::max(set_cutoff, 1u)),
+          arena(std::make_unique<Arena>()),
+          sets(std::make_unique<SetShards>())
+    {}
+
+    bool exists(Key key, Kmer kmer) const {
+        const auto &e = entries[key];
+        if (e.size >= set_cutoff)
+            return _set(key).contains(kmer, _data(e));
+        const Kmer *data = _data(e);
+        return std::find(data, data + e.size, kmer) != data + e.size;
+    }
+
+    Len add_kmer(Key key, Kmer kmer) {
+        auto &e = entries[key];
+        if (e.size == _capacity(e.size)) {
+            u64 addr = arena->alloc(_class(e.size + 1));
+            if (e.size) {
+                std::copy_n(_data(e), e.size, arena->data(addr));
+                arena->free(e.addr, _class(e.size));
+            }
+            e.addr = addr;
+        }
+        _data(e)[e.size++] = kmer;
+
+        if (e.size == set_cutoff) {
+            auto &set = _new_set(key);
+            for (Len i = 0; i < e.size; ++i)
+                set.insert(i, _data(e));
+        } else if (e.size > set_cutoff) {
+            _set(key).insert(e.size - 1, _data(e));
+        }
+        return e.size;
+    }
+
+    Len num_kmers(Key key) const { return entries[key].size; }
+    Kmer get(Key key, Len idx) const { return _data(entries[key])[idx]; }
+    std::span<const Kmer> kmers(Key key) const {
+        const auto &e = entries[key];
+        return { _data(e), e.size };
+    }
+
+    Len &done_idx(Key key) { return entries[key].done; }
+    Len done_idx(Key key) const { return entries[key].done; }
+
+    /** forget all kmers of key, and reuse the memory */
+    void release(Key key) {
+        auto &e = entries[key];
+        if (e.size >= set_cutoff)
+            _drop_set(key);
+        if (e.size)
+            arena->free(e.addr, _class(e.size));
+        e = {};
+    }
+
+    u64 num_keys() const { return entries.size(); }
+    u64 num_sets() const {
+        u64 res = 0;
+        for (const auto &shard : *sets)
+            res += shard.map.size();
+        return res;
+    }
+
+private:
+    struct Entry {
+        u64 addr = 0;
+        Len size = 0;
+        Len done = 0;
+    };
+
+    /**
+     * Blocks of 2^cls kmers. Small blocks are bump-allocated from shared
+     * chunks, big ones get a chunk of their own. Chunks never move, so
+     * pointers into the arena stay valid while other keys grow.
+     */
+    struct Arena {
+        static constexpr u32 CHUNK_LOG = 16;
+        static constexpr u64 CHUNK_SIZE = u64(1) << CHUNK_LOG;
+        static constexpr u32 MAX_CHUNKS = 1u << 16;
+        static constexpr u32 MAX_CLASS = 32;
+
+        std::vector<std::unique_ptr<Kmer[]>> chunks =
+            std::vector<std::unique_ptr<Kmer[]>>(MAX_CHUNKS);
+        u32 num_chunks = 0;
+        u32 bump_chunk = 0;
+        u64 cursor = CHUNK_SIZE; // in bump_chunk
+        std::array<std::vector<u64>, MAX_CLASS + 1> free_lists;
+        std::mutex mtx;
+
+        static u64 make_addr(u64 chunk, u64 off) { return (chunk << 32) | off; }
+
+        Kmer *data(u64 addr) const {
+            return chunks[addr >> 32].get() + (addr & 0xffffffffu);
+        }
+
+        u64 alloc(u32 cls) {
+            std::lock_guard<std::mutex> lk(mtx);
+            auto &fl = free_lists[cls];
+            if (!fl.empty()) {
+                u64 addr = fl.back();
+                fl.pop_back();
+                return addr;
+            }
+            u64 size = u64(1) << cls;
+            if (size > CHUNK_SIZE / 4)
+                return make_addr(_new_chunk(size), 0);
+            if (cursor + size > CHUNK_SIZE) {
+                bump_chunk = _new_chunk(CHUNK_SIZE);
+                cursor = 0;
+            }
+            u64 addr = make_addr(bump_chunk, cursor);
+            cursor += size;
+            return addr;
+        }
+
+        void free(u64 addr, u32 cls) {
+            std::lock_guard<std::mutex> lk(mtx);
+            free_lists[cls].push_back(addr);
+        }
+
+        u32 _new_chunk(u64 size) {
+            if (num_chunks == MAX_CHUNKS)
+                throw "kmer-build-data-out-of-chunks";
+            chunks[num_chunks] = std::make_unique_for_overwrite<Kmer[]>(size);
+            return num_chunks++;
+        }
+    };
+
+    /**
+     * Open-addressing set of indices (+1) into a key's kmer list. Kmers are
+     * compared through the list, so the set doesn't duplicate them.
+     */
+    struct KmerSet {
+        std::vector<u32> slots;
+
+        bool contains(Kmer kmer, const Kmer *data) const {
+            u32 mask = slots.size() - 1;
+            for (u32 i = _hash(kmer) & mask; slots[i]; i = (i + 1) & mask)
+                if (data[slots[i] - 1] == kmer)
+                    return true;
+            return false;
+        }
+
+        void insert(Len idx, const Kmer *data) {
+            if (2 * (idx + 1) > slots.size()) {
+                std::vector<u32> old(std::bit_ceil(std::max(16u, 4 * (idx + 1))), 0);
+                std::swap(old, slots);
+                for (u32 s : old)
+                    if (s) _put(s, data);
+            }
+            _put(idx + 1, data);
+        }
+
+        void _put(u32 s, const Kmer *data) {
+            u32 mask = slots.size() - 1;
+            u32 i = _hash(data[s - 1]) & mask;
+            while (slots[i])
+                i = (i + 1) & mask;
+            slots[i] = s;
+        }
+
+        static u32 _hash(Kmer kmer) {
+            return (u64(std::hash<Kmer>{}(kmer)) * 0x9e3779b97f4a7c15ull) >> 32;
+        }
+    };
+
+    struct SetShard {
+        std::mutex mtx;
+        std::unordered_map<Key, KmerSet> map;
+    };
+    static constexpr u32 SET_SHARDS = 64;
+    using SetShards = std::array<SetShard, SET_SHARDS>;
+
+    std::vector<Entry> entries;
+    u32 set_cutoff;
+    std::unique_ptr<Arena> arena;
+    std::unique_ptr<SetShards> sets;
+
+    static u32 _class(Len size) { return std::bit_width(size - 1); }
+    static Len _capacity(Len size) { return size ? std::bit_ceil(size) : 0; }
+    Kmer *_data(const Entry &e) const { return arena->data(e.addr); }
+
+    // unordered_map never moves its elements, so the reference outlives
+    // the shard lock
+    KmerSet &_set(Key key) const {
+        auto &shard = (*sets)[key % SET_SHARDS];
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        return shard.map.find(key)->second;
+    }
+
+    KmerSet &_new_set(Key key) {
+        auto &shard = (*sets)[key % SET_SHARDS];
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        return shard.map[key];
+    }
+
+    void _drop_set(Key key) {
+        auto &shard = (*sets)[key % SET_SHARDS];
+        std::lock_guard<std::mutex> lk(shard.mtx);
+        shard.map.erase(key);
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __TRIE_BUILDER_KMER_BUILD_DATA_H__ */
@@ -7,7 +7,7 @@
 #define __TRIE_BUILDER_LBFS_H__
 
 #include "triegraph/graph/connected_components.h"
-#include "triegraph/util/short_vector.h"
+#include "triegraph/trie/builder/kmer_build_data.h"
 #include "triegraph/util/util.h"
 #include "triegraph/util/logger.h"
 
@@ -36,7 +36,7 @@ struct TrieBuilderLBFS {
     using NodeLoc = Graph::NodeLoc;
     using LetterLoc = LetterLocData::LetterLoc;
     using NodePos = LetterLocData::NodePos;
-    using kmer_len_type = u32; // how many kmers per location
+    using KmerBuildData = triegraph::KmerBuildData<Kmer, LetterLoc>;
 
     using Self = TrieBuilderLBFS;
     // using pairs_t = std::vector<std::pair<Kmer, LetterLoc>>;
@@ -56,14 +56,11 @@ struct TrieBuilderLBFS {
         u32 maxk;
         u32 maxc;
         u32 maxid;
-        u32 qsearch;
-        u32 ssearch;
         u32 nsets;
 
         Stats()
             : qpush(), qpop(), double_pop(), kpush(), kproc(), ksame(),
-            tnodes(), maxk(), maxc(), maxid(), qsearch(), ssearch(),
-            nsets() {
+            tnodes(), maxk(), maxc(), maxid(), nsets() {
         }
 
         friend std::ostream &operator<< (std::ostream &os, const Stats &s) {
@@ -78,8 +75,6 @@ struct TrieBuilderLBFS {
                 << "maxk " << s.maxk << "\n"
                 << "maxk " << s.maxc << "\n"
                 << "maxid " << s.maxid << "\n"
-                << "qsearch " << s.qsearch << "\n"
-                << "ssearch " << s.ssearch << "\n"
                 << "nsets " << s.nsets;
         }
     } stats;
@@ -96,11 +91,19 @@ struct TrieBuilderLBFS {
     struct Settings {
         static constexpr u32 default_set_cutoff = 500u;
         u32 set_cutoff = default_set_cutoff;
+        /**
+         * emit the pairs of a location (and free its kmers) as soon as all
+         * of its predecessors are done. Locations on cycles are still kept
+         * until the end.
+         */
+        bool streaming = false;
 
         static Settings from_config(const auto &cfg) {
             return {
                 .set_cutoff = cfg.template get_or<u32>(
-                        "trie-builder-lbfs-set-cutoff", default_set_cutoff)
+                        "trie-builder-lbfs-set-cutoff", default_set_cutoff),
+                .streaming = cfg.template get_or<bool>(
+                        "trie-builder-lbfs-streaming", false),
             };
         }
     } settings_;
@@ -120,54 +123,11 @@ struct TrieBuilderLBFS {
         _fill_pairs(std::move(kmer_data));
     }
 
-    struct KmerBuildData {
-        std::vector<ShortVector<Kmer>> kmers;
-        std::vector<std::unordered_set<Kmer>> kmers_set;
-        std::vector<kmer_len_type> done_idx;
-
-        const u32 set_cutoff;
-        Stats &stats;
-
-        KmerBuildData(LetterLoc num, u32 set_cutoff, Stats &stats)
-                : kmers(num+1),
-                  kmers_set(num+1),
-                  done_idx(num+1),
-                  set_cutoff(set_cutoff),
-                  stats(stats)
-        {}
-
-        bool exists(LetterLoc pos, Kmer kmer) const {
-            auto &pkmers = kmers[pos];
-            if (pkmers.size() >= set_cutoff) {
-                ++stats.qsearch;
-                return kmers_set[pos].contains(kmer);
-            } else {
-                ++stats.ssearch;
-                return std::find(pkmers.begin(), pkmers.end(), kmer) != pkmers.end();
-            }
-        }
-
-        kmer_len_type add_kmer(LetterLoc pos, Kmer kmer) {
-            auto &pkmers = kmers[pos];
-            pkmers.emplace_back(kmer);
-
-            if (pkmers.size() == set_cutoff) {
-                ++stats.nsets;
-                kmers_set[pos].insert(pkmers.begin(), pkmers.end());
-            } else if (pkmers.size() > set_cutoff) {
-                kmers_set[pos].insert(kmer);
-            }
-            return pkmers.size();
-        }
-
-        kmer_len_type num_kmers(LetterLoc pos) const {
-            return kmers[pos].size();
-        }
-    };
-
     KmerBuildData _bfs_trie(const std::vector<NodeLoc> &starts) {
         // std::cerr << "==== bfs_trie" << std::endl;
-        KmerBuildData kb(lloc.num_locations, settings_.set_cutoff, stats);
+        KmerBuildData kb(lloc.num_locations + 1, settings_.set_cutoff);
+        if (settings_.streaming)
+            _init_pending();
 
         std::queue<NodePos> q;
 
@@ -177,7 +137,7 @@ struct TrieBuilderLBFS {
             ++ stats.kpush;
             ++ stats.tnodes;
             q.push(h);
-            kb.kmers[lloc.compress(h)].push_back(Kmer::empty());
+            kb.add_kmer(lloc.compress(h), Kmer::empty());
         }
 
         bool verbose_mode = false;
@@ -185,7 +145,7 @@ struct TrieBuilderLBFS {
             auto h = q.front(); q.pop();
             ++ stats.qpop;
 
-            if (kb.done_idx[h.node] > 0) {
+            if (kb.done_idx(h.node) > 0) {
                 ++ stats.double_pop;
             }
 
@@ -202,15 +162,14 @@ struct TrieBuilderLBFS {
             }
 
             if (verbose_mode)
-                std::cerr << "ksz " << kb.kmers[hc].size() << "\n"
-                        << "ktd " << kb.done_idx[hc] << "\n"
+                std::cerr << "ksz " << kb.num_kmers(hc) << "\n"
+                        << "ktd " << kb.done_idx(hc) << "\n"
                         << "tgts " << targets.size() << std::endl;
 
-            auto &done_idx = kb.done_idx[hc];
-            auto &kmers = kb.kmers[hc];
+            auto &done_idx = kb.done_idx(hc);
             auto letter = graph.node(h.node).seg[h.pos];
-            for (; done_idx < kmers.size(); ++done_idx) {
-                auto kmer = kmers[done_idx];
+            for (; done_idx < kb.num_kmers(hc); ++done_idx) {
+                auto kmer = kb.get(hc, done_idx);
                 ++ stats.kproc;
                 kmer.push(letter);
                 for (auto t: targets) {
@@ -219,7 +178,7 @@ struct TrieBuilderLBFS {
                         ++ stats.ksame;
                         continue;
                     }
-                    auto t_done = kb.done_idx[tc];
+                    auto t_done = kb.done_idx(tc);
                     ++ stats.kpush;
                     auto nk = kb.add_kmer(tc, kmer);
                     // t_kmers.emplace_back(kmer);
@@ -239,21 +198,64 @@ struct TrieBuilderLBFS {
                     }
                 }
             }
+            if (settings_.streaming && pending[hc] == 0)
+                _finalize(kb, h);
         }
+        stats.nsets = kb.num_sets();
         return kb;
     }
 
-    void _print_stats(KmerBuildData kb) {
+    // pending[loc] -- number of predecessor locations, not yet finalized
+    std::vector<u32> pending;
+    std::vector<NodePos> to_finalize;
+
+    void _init_pending() {
+        pending.assign(lloc.num_locations + 1, 1);
+        for (NodeLoc node = 0; node < graph.num_nodes(); ++node) {
+            auto &p = pending[lloc.compress(NodePos(node, 0))];
+            p = 0;
+            for (const auto &_ : graph.backward_from(node)) {
+                (void) _;
+                ++p;
+            }
+        }
+    }
+
+    // h has no predecessors left, and all its kmers are propagated, so
+    // it will never change again
+    void _finalize(KmerBuildData &kb, NodePos h) {
+        to_finalize.push_back(h);
+        while (!to_finalize.empty()) {
+            auto h = to_finalize.back(); to_finalize.pop_back();
+            auto hc = lloc.compress(h);
+            for (const auto &kmer : kb.kmers(hc))
+                if (kmer.is_complete())
+                    pairs.emplace_back(kmer, hc);
+            kb.release(hc);
+
+            auto done = [&](NodePos t) {
+                auto tc = lloc.compress(t);
+                // if t is still in the queue, it's finalized after the pop
+                if (--pending[tc] == 0 && kb.done_idx(tc) == kb.num_kmers(tc))
+                    to_finalize.push_back(t);
+            };
+            if (graph.node(h.node).seg.size() == h.pos + 1) {
+                for (const auto &to : graph.forward_from(h.node))
+                    done(NodePos(to.node_id, 0));
+            } else {
+                done(NodePos(h.node, h.pos + 1));
+            }
+        }
+    }
+
+    void _print_stats(const KmerBuildData &kb) {
         std::cerr << "printing stats" << std::endl;
         int buckets[31] = {0,};
         long long total = 0;
-        long long fast = 0;
         for (LetterLoc i = 0; i <= lloc.num_locations; ++i) {
-            buckets[log2_ceil(kb.kmers[i].size())] += 1;
-            total += kb.kmers[i].size();
-            fast += kb.kmers[i].is_fast();
+            buckets[log2_ceil(kb.num_kmers(i))] += 1;
+            total += kb.num_kmers(i);
         }
-        std::cerr << "fast " << fast << " " << lloc.num_locations << std::endl;
         long long ctot = 0;
         for (int i = 0; i < 31; ++i) {
             ctot += buckets[i];
@@ -263,15 +265,16 @@ struct TrieBuilderLBFS {
         std::cerr << "num locations " << lloc.num_locations << std::endl;
     }
 
+    // in streaming mode, only locations on cycles are left
     void _fill_pairs(KmerBuildData kb) {
         u64 total = 0;
-        assert(kb.kmers.size() == 1 + lloc.num_locations);
+        assert(kb.num_keys() == 1 + lloc.num_locations);
         for (LetterLoc i = 0; i <= lloc.num_locations; ++i) {
-            total += kb.kmers[i].size();
+            total += kb.num_kmers(i);
         }
-        pairs.reserve(total);
+        pairs.reserve(pairs.size() + total);
         for (LetterLoc i = 0; i <= lloc.num_locations; ++i) {
-            for (const auto &kmer : kb.kmers[i]) {
+            for (const auto &kmer : kb.kmers(i)) {
                 if (kmer.is_complete()) {
                     pairs.emplace_back(kmer, i);
                 }
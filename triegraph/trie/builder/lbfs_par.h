@@ -0,0 +1,218 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TRIE_BUILDER_LBFS_PAR_H__
+#define __TRIE_BUILDER_LBFS_PAR_H__
+
+#include "triegraph/graph/connected_components.h"
+#include "triegraph/trie/builder/kmer_build_data.h"
+#include "triegraph/util/logger.h"
+#include "triegraph/util/striped_lock.h"
+#include "triegraph/util/thread_pool.h"
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Frontier-parallel Location BFS.
+ *
+ * Same as TrieBuilderLBFS, but instead of popping one location at a time, the
+ * whole frontier (all queued locations) is expanded at once across threads.
+ *
+ * Every location is guarded by a striped lock. While expanding a location,
+ * its unprocessed kmers are copied out (under its lock) into a thread-local
+ * scratch buffer, then pushed to each target (under the target's lock).
+ * Locations that receive new kmers form the next frontier.
+ */
+template <typename Graph_, typename LetterLocData_, typename Kmer_, typename VectorPairs_>
+struct TrieBuilderLBFSPar {
+    using Graph = Graph_;
+    using LetterLocData = LetterLocData_;
+    using Kmer = Kmer_;
+    using VectorPairs = VectorPairs_;
+    using NodeLoc = Graph::NodeLoc;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using NodePos = LetterLocData::NodePos;
+    using KmerBuildData = triegraph::KmerBuildData<Kmer, LetterLoc>;
+
+    using Self = TrieBuilderLBFSPar;
+
+    const Graph &graph;
+    const LetterLocData &lloc;
+    VectorPairs &pairs;
+
+    TrieBuilderLBFSPar(const Graph &graph, const LetterLocData &lloc, VectorPairs &pairs)
+        : graph(graph), lloc(lloc), pairs(pairs) {
+    }
+
+    TrieBuilderLBFSPar(const Self &) = delete;
+    TrieBuilderLBFSPar(Self &&) = delete;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = delete;
+
+    struct Settings {
+        static constexpr u32 default_set_cutoff = 500u;
+        static constexpr u32 default_num_threads = 0u; // hardware concurrency
+        static constexpr u32 default_min_parallel_frontier = 64u;
+        u32 set_cutoff = default_set_cutoff;
+        /** number of threads, including the calling one */
+        u32 num_threads = default_num_threads;
+        /** smaller frontiers are expanded on the calling thread */
+        u32 min_parallel_frontier = default_min_parallel_frontier;
+
+        static Settings from_config(const auto &cfg) {
+            return {
+                .set_cutoff = cfg.template get_or<u32>(
+                        "trie-builder-lbfs-set-cutoff", default_set_cutoff),
+                .num_threads = cfg.template get_or<u32>(
+                        "trie-builder-lbfs-par-threads", default_num_threads),
+                .min_parallel_frontier = cfg.template get_or<u32>(
+                        "trie-builder-lbfs-par-min-frontier",
+                        default_min_parallel_frontier),
+            };
+        }
+    } settings_;
+
+    Self &set_settings(Settings &&s) { settings_ = std::move(s); return *this; }
+    const Settings &settings() const { return settings_; }
+
+    void compute_pairs(std::ranges::input_range auto&& /* starts */) {
+        auto &log = Logger::get();
+        auto scope = log.begin_scoped("bfs_par builder");
+
+        log.begin("starting points");
+        auto starts = ConnectedComponents<Graph>(graph).compute_starting_points();
+        log.end().begin("bfs");
+        KmerBuildData kb(lloc.num_locations + 1, settings_.set_cutoff);
+        u32 rounds = _bfs_trie(kb, starts);
+        log.end().begin("converting to pairs");
+        _fill_pairs(std::move(kb));
+        log.end();
+        log.log("threads", num_threads, "rounds", rounds);
+    }
+
+private:
+    struct Worker {
+        std::vector<Kmer> scratch;
+        std::vector<NodePos> next;
+    };
+
+    StripedLock locks;
+    // queued[loc] is set while loc is in the (current or next) frontier,
+    // and it has unprocessed kmers. Guarded by the striped lock of loc.
+    std::vector<u8> queued;
+    u32 num_threads = 1;
+
+    u32 _bfs_trie(KmerBuildData &kb, const std::vector<NodeLoc> &starts) {
+        ThreadPool pool(settings_.num_threads);
+        num_threads = pool.size();
+        std::vector<Worker> workers(pool.size());
+        queued.assign(lloc.num_locations + 1, 0);
+
+        std::vector<NodePos> frontier;
+        for (auto start : starts) {
+            auto h = NodePos(start, 0);
+            auto hc = lloc.compress(h);
+            frontier.push_back(h);
+            queued[hc] = 1;
+            kb.add_kmer(hc, Kmer::empty());
+        }
+
+        u32 rounds = 0;
+        while (!frontier.empty()) {
+            ++rounds;
+            auto expand = [&](u32 tid, u64 beg, u64 end) {
+                for (u64 i = beg; i < end; ++i)
+                    _expand(kb, workers[tid], frontier[i]);
+            };
+            if (frontier.size() < settings_.min_parallel_frontier) {
+                expand(0, 0, frontier.size());
+            } else {
+                pool.parallel_for(frontier.size(),
+                        std::max(u64(1), u64(frontier.size() / (pool.size() * 8))),
+                        expand);
+            }
+
+            frontier.clear();
+            for (auto &w : workers) {
+                frontier.insert(frontier.end(), w.next.begin(), w.next.end());
+                w.next.clear();
+            }
+        }
+        return rounds;
+    }
+
+    void _expand(KmerBuildData &kb, Worker &w, NodePos h) {
+        auto hc = lloc.compress(h);
+        auto letter = graph.node(h.node).seg[h.pos];
+
+        w.scratch.clear();
+        {
+            auto lk = locks.lock(hc);
+            auto &done_idx = kb.done_idx(hc);
+            for (; done_idx < kb.num_kmers(hc); ++done_idx) {
+                auto kmer = kb.get(hc, done_idx);
+                kmer.push(letter);
+                w.scratch.push_back(kmer);
+            }
+            queued[hc] = 0;
+        }
+        if (w.scratch.empty())
+            return;
+
+        if (graph.node(h.node).seg.size() == h.pos + 1) {
+            for (const auto &to : graph.forward_from(h.node))
+                _push_target(kb, w, NodePos(to.node_id, 0));
+        } else {
+            _push_target(kb, w, NodePos(h.node, h.pos + 1));
+        }
+    }
+
+    void _push_target(KmerBuildData &kb, Worker &w, NodePos t) {
+        auto tc = lloc.compress(t);
+        auto lk = locks.lock(tc);
+        bool added = false;
+        for (const auto &kmer : w.scratch) {
+            if (kb.exists(tc, kmer))
+                continue;
+            kb.add_kmer(tc, kmer);
+            added = true;
+        }
+        if (added && !queued[tc]) {
+            queued[tc] = 1;
+            w.next.push_back(t);
+        }
+    }
+
+    void _fill_pairs(KmerBuildData kb) {
+        u64 total = 0;
+        for (LetterLoc i = 0; i <= lloc.num_locations; ++i) {
+            total += kb.num_kmers(i);
+        }
+        pairs.reserve(total);
+        for (LetterLoc i = 0; i <= lloc.num_locations; ++i) {
+            for (const auto &kmer : kb.kmers(i)) {
+                if (kmer.is_complete()) {
+                    pairs.emplace_back(kmer, i);
+                }
+            }
+        }
+
+        // destroy kb
+        {
+            auto scope = Logger::get().begin_scoped("freeing aux");
+            auto _ = std::move(kb);
+        }
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __TRIE_BUILDER_LBFS_PAR_H__ */
@@ -7,9 +7,11 @@
 #define __TRIE_BUILDER_NBFS_H__
 
 #include "triegraph/graph/top_order.h"
+#include "triegraph/trie/builder/kmer_build_data.h"
+#include "triegraph/trie/kmer_roller.h"
 #include "triegraph/util/util.h"
 #include "triegraph/util/logger.h"
-#include "triegraph/util/short_vector.h"
+#include "triegraph/util/vector_pairs.h"
 
 #include <vector>
 #include <queue>
@@ -37,9 +39,9 @@ struct TrieBuilderNBFS {
     using LetterLoc = LetterLocData::LetterLoc;
     using Kmer = Kmer_;
     using VectorPairs = VectorPairs_;
-    using KmerPerNodeLen = Kmer::Holder;
     using Str = Graph::Str;
     using TopOrder = triegraph::TopOrder<Graph>;
+    using KmerBuildData = triegraph::KmerBuildData<Kmer, NodeLoc>;
     using Self = TrieBuilderNBFS;
 
     const Graph &graph;
@@ -47,20 +49,33 @@ struct TrieBuilderNBFS {
     VectorPairs &pairs;
 
     TopOrder top_ord;
-    std::priority_queue<NodeLoc, std::vector<NodeLoc>, typename TopOrder::Comparator> q;
-    std::vector<bool> in_q;
 
     TrieBuilderNBFS(const Graph &graph, const LetterLocData &lloc, VectorPairs &pairs)
         : graph(graph),
           lloc(lloc),
           pairs(pairs),
           top_ord(typename TopOrder::Builder(graph).build()),
-          q(top_ord.comp()),
-          in_q(graph.num_nodes(), false),
           kd(graph.num_nodes())
     {}
 
-    struct Settings { static Settings from_config(auto &&) { return {}; } } settings_;
+    struct Settings {
+        /** use a binary heap, instead of the bucket queue */
+        bool heap_queue = false;
+        /**
+         * buffer pairs per node, and output them sorted by location (and
+         * unique), so the first sort in TrieData is skipped
+         */
+        bool sorted_output = false;
+
+        static Settings from_config(const auto &cfg) {
+            return {
+                .heap_queue = cfg.template get_or<bool>(
+                        "trie-builder-nbfs-heap-queue", false),
+                .sorted_output = cfg.template get_or<bool>(
+                        "trie-builder-nbfs-sorted-output", false),
+            };
+        }
+    } settings_;
     Self &set_settings(Settings &&s) { settings_ = s; return *this; }
     const Settings &settings() const { return settings_; }
 
@@ -68,161 +83,126 @@ struct TrieBuilderNBFS {
         auto scope = Logger::get().begin_scoped("node_bfs builder");
 
         auto starts = ConnectedComponents(graph).compute_starting_points();
-        for (const auto &node : starts) {
-            in_q[node] = true;
-            q.push(node);
-            kd.add_kmer(node, Kmer::empty());
-            // std::cerr << "start: Pushing node " << node << std::endl;
+        if (settings_.sorted_output)
+            buckets.resize(graph.num_nodes());
+        if (settings_.heap_queue) {
+            _bfs(typename TopOrder::HeapQueue(top_ord), starts);
+        } else {
+            _bfs(typename TopOrder::Queue(top_ord), starts);
         }
-
-        _bfs();
+        if (settings_.sorted_output)
+            _flush_buckets();
     }
 
-private:
-    /**
-     * This is similar to KmerBuildData from BFS builder, but this one stores
-     * kmers for each graph node, where as the other one stores kmers for every
-     * letter location.
-     *
-     * It could be shared, the code is exactly the same.
-     */
-    struct KmerBuildData {
-
-        static constexpr u32 SET_CUTOFF = 500;
-        std::vector<ShortVector<Kmer>> kmers;
-        // std::vector<std::vector<Kmer>> kmers;
-        std::vector<std::unordered_set<Kmer>> kmers_set;
-        std::vector<KmerPerNodeLen> done_idx;
-
-        // Stats &stats;
-
-        KmerBuildData(NodeLoc num_nodes)
-            : kmers(num_nodes),
-              kmers_set(num_nodes),
-              done_idx(num_nodes)
-        {}
-
-        bool exists(NodeLoc node, Kmer kmer) const {
-            auto &pkmers = kmers[node];
-            if (pkmers.size() >= SET_CUTOFF) {
-                // ++stats.qsearch;
-                return kmers_set[node].contains(kmer);
-            } else {
-                // ++stats.ssearch;
-                return std::find(pkmers.begin(), pkmers.end(), kmer) != pkmers.end();
-            }
-        }
+    KmerBuildData kd;
 
-        KmerPerNodeLen add_kmer(NodeLoc node, Kmer kmer) {
-            auto &pkmers = kmers[node];
-            pkmers.emplace_back(kmer);
-
-            if (pkmers.size() == SET_CUTOFF) {
-                // ++stats.nsets;
-                kmers_set[node].insert(pkmers.begin(), pkmers.end());
-            } else if (pkmers.size() > SET_CUTOFF) {
-                kmers_set[node].insert(kmer);
-            }
-            return pkmers.size();
-        }
+private:
+    // per node pairs, used for sorted_output
+    std::vector<std::vector<std::pair<Kmer, LetterLoc>>> buckets;
 
-        KmerPerNodeLen num_kmers(NodeLoc node) const {
-            return kmers[node].size();
+    template <typename Queue>
+    void _bfs(Queue &&q, const std::vector<NodeLoc> &starts) {
+        for (const auto &node : starts) {
+            q.push(node);
+            kd.add_kmer(node, Kmer::empty());
+            // std::cerr << "start: Pushing node " << node << std::endl;
         }
-    } kd;
 
-    void _bfs() {
         while (!q.empty()) {
-            auto nid = q.top(); q.pop(); in_q[nid] = false;
+            auto nid = q.pop();
             // std::cerr << "popping " << nid << std::endl;
             const auto &node = graph.node(nid);
-            auto &done_idx = kd.done_idx[nid];
+            auto &done_idx = kd.done_idx(nid);
 
             LetterLoc loc = lloc.compress(NodePos(nid, 0));
 
             if (node.seg.size() >= Kmer::K) {
                 // std::cerr << "case 1" << std::endl;
                 Kmer kmer;
-                for (; done_idx < kd.kmers[nid].size(); ++done_idx) {
-                    kmer = kd.kmers[nid][done_idx];
+                for (; done_idx < kd.num_kmers(nid); ++done_idx) {
+                    kmer = kd.get(nid, done_idx);
                     if (kmer.is_complete())
-                        pairs.emplace_back(kmer, loc);
-                    _walk_node(kmer, node.seg, loc, 1, Kmer::K);
+                        _emit(nid, kmer, loc);
+                    _walk_node(nid, kmer, node.seg, loc, 1, Kmer::K);
                     // for (NodeLen i = 1; i < Kmer::K; ++i) {
                     //     kmer.push_back(node.seg[i-1]);
                     //     pairs.emplace_back(kmer, loc + i);
                     // }
                 }
-                _walk_node(kmer, node.seg, loc, Kmer::K, node.seg.size());
+                _walk_node(nid, kmer, node.seg, loc, Kmer::K, node.seg.size());
                 // for (NodeLen i = Kmer::K; i < node.seg.size(); ++i) {
                 //     kmer.push_back(node.seg[i-1]);
                 //     pairs.emplace_back(kmer, loc + i);
                 // }
                 kmer.push_back(node.seg.back());
-                _push_neighbours(kmer, nid);
-                // for (const auto &fwd : graph.forward_from(nid)) {
-                //     if (!kd.exists(fwd.node_id, kmer)) {
-                //         kd.add_kmer(fwd.node_id, kmer);
-                //         if (!in_q[fwd.node_id]) {
-                //             in_q[fwd.node_id] = true;
-                //             q.push(fwd.node_id);
-                //         }
-                //     }
-                // }
+                _push_neighbours(q, kmer, nid);
             } else {
                 // std::cerr << "case 2" << std::endl;
                 // many starting, many ending
-                for (; done_idx < kd.kmers[nid].size(); ++done_idx) {
-                    Kmer kmer = kd.kmers[nid][done_idx];
+                for (; done_idx < kd.num_kmers(nid); ++done_idx) {
+                    Kmer kmer = kd.get(nid, done_idx);
                     if (kmer.is_complete())
-                        pairs.emplace_back(kmer, loc);
-                    _walk_node(kmer, node.seg, loc, 1, node.seg.size());
+                        _emit(nid, kmer, loc);
+                    _walk_node(nid, kmer, node.seg, loc, 1, node.seg.size());
                     // for (NodeLen i = 1; i < node.seg.size(); ++i) {
                     //     kmer.push_back(node.seg[i-1]);
                     //     pairs.emplace_back(kmer, loc + i);
                     // }
                     kmer.push_back(node.seg.back());
-                    _push_neighbours(kmer, nid);
-                    // for (const auto &fwd : graph.forward_from(nid)) {
-                    //     if (!kd.exists(fwd.node_id, kmer)) {
-                    //         kd.add_kmer(fwd.node_id, kmer);
-                    //         if (!in_q[fwd.node_id]) {
-                    //             in_q[fwd.node_id] = true;
-                    //             q.push(fwd.node_id);
-                    //         }
-                    //     }
-                    // }
+                    _push_neighbours(q, kmer, nid);
                 }
             }
         }
     }
 
-    void _walk_node(Kmer &kmer, const Str &seg,
+    void _walk_node(NodeLoc nid, Kmer &kmer, const Str &seg,
             LetterLoc loc, NodeLen start, NodeLen end) {
         // std::cerr << "walk node '" << kmer << "' "
         //     << loc << " " << start << " "
         //     << end << std::endl;
 
         // pairs.emplace_back(kmer, loc);
-        for (NodeLen i = start; i < end; ++i) {
-            kmer.push_back(seg[i-1]);
-            if (kmer.is_complete())
-                pairs.emplace_back(kmer, loc + i);
+        KmerRoller<Kmer>::walk(kmer, seg, start, end,
+                [&](const Kmer &k, NodeLen i) { _emit(nid, k, loc + i); });
+    }
+
+    void _emit(NodeLoc nid, const Kmer &kmer, LetterLoc loc) {
+        if (settings_.sorted_output)
+            buckets[nid].emplace_back(kmer, loc);
+        else
+            pairs.emplace_back(kmer, loc);
+    }
+
+    // Locations of a node are consecutive, and increase with node id, so
+    // concatenating sorted buckets gives pairs sorted by location (unless
+    // pairs had some already).
+    void _flush_buckets() {
+        auto scope = Logger::get().begin_scoped("flushing buckets");
+        bool was_empty = pairs.size() == 0;
+        u64 total = 0;
+        for (const auto &bucket : buckets)
+            total += bucket.size();
+        pairs.reserve(pairs.size() + total);
+
+        for (auto &bucket : buckets) {
+            std::ranges::sort(bucket, [](const auto &a, const auto &b) {
+                return a.second != b.second ? a.second < b.second : a.first < b.first;
+            });
+            auto ur = std::ranges::unique(bucket);
+            for (auto it = bucket.begin(); it != ur.begin(); ++it)
+                pairs.emplace_back(it->first, it->second);
+            std::vector<std::pair<Kmer, LetterLoc>>().swap(bucket);
         }
+        buckets = {};
+        pairs.set_order(was_empty ? VectorPairsOrder::REV : VectorPairsOrder::NONE);
     }
 
-    void _push_neighbours(Kmer &kmer, NodeLoc nid) {
+    void _push_neighbours(auto &q, Kmer &kmer, NodeLoc nid) {
         // std::cerr << "push neighbour " << kmer << " " << nid << std::endl;
         for (const auto &fwd : graph.forward_from(nid)) {
             if (!kd.exists(fwd.node_id, kmer)) {
                 kd.add_kmer(fwd.node_id, kmer);
-                if (!in_q[fwd.node_id]) {
-                    // std::cerr << " Push " << fwd.node_id << std::endl;
-                    in_q[fwd.node_id] = true;
-                    q.push(fwd.node_id);
-                } else {
-                    // std::cerr << " already pushed " << fwd.node_id << std::endl;
-                }
+                q.push(fwd.node_id);
             }
         }
     }
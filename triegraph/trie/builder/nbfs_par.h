@@ -0,0 +1,300 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TRIE_BUILDER_NBFS_PAR_H__
+#define __TRIE_BUILDER_NBFS_PAR_H__
+
+#include "triegraph/graph/connected_components.h"
+#include "triegraph/graph/top_order.h"
+#include "triegraph/trie/builder/kmer_build_data.h"
+#include "triegraph/trie/kmer_roller.h"
+#include "triegraph/util/logger.h"
+#include "triegraph/util/striped_lock.h"
+#include "triegraph/util/thread_pool.h"
+#include "triegraph/util/util.h"
+#include "triegraph/util/vector_pairs.h"
+
+#include <algorithm>
+#include <mutex>
+#include <ranges>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Parallel Node BFS -- level-synchronous version of TrieBuilderNBFS.
+ *
+ * Every node gets a level: the longest path to it, following only edges that
+ * are not back-edges in the Topological Order. Nodes on the same level don't
+ * depend on each other, so a level (wavefront) is processed concurrently.
+ *
+ * Kmers pushed along forward edges always go to a higher level, so they are
+ * added directly, under a per-node striped lock. Kmers pushed along back-edges
+ * may target a node that is being read, so they are buffered per thread and
+ * merged at the level barrier. Nodes that receive kmers over a back-edge are
+ * re-processed in the next sweep over the levels, until nothing changes.
+ *
+ * Pairs are collected in thread-local buffers and flushed into the shared
+ * pairs container under a lock, unless it is a concurrent sink, which is
+ * written directly.
+ */
+template <typename Graph_,
+         typename LetterLocData_,
+         typename Kmer_,
+         typename VectorPairs_>
+struct TrieBuilderNBFSPar {
+    using Graph = Graph_;
+    using LetterLocData = LetterLocData_;
+    using NodeLoc = Graph::NodeLoc;
+    using NodePos = LetterLocData::NodePos;
+    using NodeLen = LetterLocData::NodeLen;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using Kmer = Kmer_;
+    using VectorPairs = VectorPairs_;
+    using Str = Graph::Str;
+    using TopOrder = triegraph::TopOrder<Graph>;
+    using KmerBuildData = triegraph::KmerBuildData<Kmer, NodeLoc>;
+    using Self = TrieBuilderNBFSPar;
+
+    const Graph &graph;
+    const LetterLocData &lloc;
+    VectorPairs &pairs;
+
+    TrieBuilderNBFSPar(const Graph &graph, const LetterLocData &lloc, VectorPairs &pairs)
+        : graph(graph),
+          lloc(lloc),
+          pairs(pairs),
+          kd(graph.num_nodes()),
+          active(graph.num_nodes(), 0)
+    {}
+
+    TrieBuilderNBFSPar(const Self &) = delete;
+    TrieBuilderNBFSPar(Self &&) = delete;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = delete;
+
+    struct Settings {
+        static constexpr u32 default_num_threads = 0u; // hardware concurrency
+        static constexpr u32 default_min_parallel_level = 16u;
+        /** number of threads, including the calling one */
+        u32 num_threads = default_num_threads;
+        /** levels with fewer nodes are processed on the calling thread */
+        u32 min_parallel_level = default_min_parallel_level;
+
+        static Settings from_config(const auto &cfg) {
+            return {
+                .num_threads = cfg.template get_or<u32>(
+                        "trie-builder-nbfs-par-threads", default_num_threads),
+                .min_parallel_level = cfg.template get_or<u32>(
+                        "trie-builder-nbfs-par-min-level", default_min_parallel_level),
+            };
+        }
+    } settings_;
+
+    Self &set_settings(Settings &&s) { settings_ = std::move(s); return *this; }
+    const Settings &settings() const { return settings_; }
+
+    void compute_pairs(std::ranges::input_range auto&& /* starts */) {
+        auto &log = Logger::get();
+        auto scope = log.begin_scoped("node_bfs_par builder");
+
+        ThreadPool pool(settings_.num_threads);
+        workers.resize(pool.size());
+
+        log.begin("levels");
+        _compute_levels();
+        buckets.resize(num_levels);
+        next_buckets.resize(num_levels);
+
+        log.end().begin("bfs");
+        auto starts = ConnectedComponents(graph).compute_starting_points();
+        for (const auto &node : starts) {
+            kd.add_kmer(node, Kmer::empty());
+            active[node] = 1;
+            buckets[level[node]].push_back(node);
+        }
+
+        u32 sweeps = 0;
+        for (bool more = true; more; ++sweeps) {
+            more = _sweep(pool);
+        }
+
+        for (u32 tid = 0; tid < workers.size(); ++tid)
+            _flush(workers[tid]);
+        log.end();
+        log.log("threads", pool.size(), "levels", num_levels, "sweeps", sweeps);
+    }
+
+private:
+    struct Worker {
+        std::vector<std::pair<Kmer, LetterLoc>> out;
+        std::vector<NodeLoc> activated;
+        std::vector<std::pair<NodeLoc, Kmer>> deferred;
+    };
+    static constexpr u32 FLUSH_SIZE = 1u << 14;
+
+    KmerBuildData kd;
+    TopOrder top_ord;
+    std::vector<NodeLoc> level;
+    NodeLoc num_levels = 0;
+    // active[n] is set while n is waiting in a bucket. Guarded by the
+    // striped lock of n.
+    std::vector<u8> active;
+    std::vector<std::vector<NodeLoc>> buckets;
+    std::vector<std::vector<NodeLoc>> next_buckets;
+    std::vector<Worker> workers;
+    StripedLock locks;
+    std::mutex pairs_mtx;
+
+    void _compute_levels() {
+        top_ord = typename TopOrder::Builder(graph).build();
+        level.assign(graph.num_nodes(), 0);
+        num_levels = graph.num_nodes() ? 1 : 0;
+        for (auto nid : top_ord.get_ordered_nodes()) {
+            for (const auto &fwd : graph.forward_from(nid)) {
+                if (_is_backedge(nid, fwd.node_id))
+                    continue;
+                level[fwd.node_id] = std::max(level[fwd.node_id], level[nid] + 1);
+                num_levels = std::max(num_levels, level[fwd.node_id] + 1);
+            }
+        }
+    }
+
+    bool _is_backedge(NodeLoc from, NodeLoc to) const {
+        return top_ord.idx[from] <= top_ord.idx[to];
+    }
+
+    // returns true if another sweep is needed
+    bool _sweep(ThreadPool &pool) {
+        for (NodeLoc lvl = 0; lvl < num_levels; ++lvl) {
+            auto &crnt = buckets[lvl];
+            if (crnt.empty())
+                continue;
+
+            auto process = [this, &crnt](u32 tid, u64 beg, u64 end) {
+                for (u64 i = beg; i < end; ++i)
+                    _process(workers[tid], crnt[i]);
+            };
+            if (crnt.size() < settings_.min_parallel_level || pool.size() == 1) {
+                process(0, 0, crnt.size());
+            } else {
+                pool.parallel_for(crnt.size(),
+                        std::max(u64(1), u64(crnt.size() / (pool.size() * 8))),
+                        process);
+            }
+            crnt.clear();
+
+            _merge_level(lvl);
+        }
+
+        bool more = false;
+        for (NodeLoc lvl = 0; lvl < num_levels; ++lvl) {
+            std::swap(buckets[lvl], next_buckets[lvl]);
+            more = more || !buckets[lvl].empty();
+        }
+        return more;
+    }
+
+    // runs on the calling thread, after all nodes on lvl are processed
+    void _merge_level(NodeLoc lvl) {
+        for (auto &w : workers) {
+            for (auto nid : w.activated)
+                buckets[level[nid]].push_back(nid);
+            w.activated.clear();
+        }
+        for (auto &w : workers) {
+            for (const auto &[nid, kmer] : w.deferred) {
+                if (kd.exists(nid, kmer))
+                    continue;
+                kd.add_kmer(nid, kmer);
+                if (!active[nid]) {
+                    active[nid] = 1;
+                    // still ahead in this sweep, or wait for the next one
+                    (level[nid] > lvl ? buckets : next_buckets)[level[nid]].push_back(nid);
+                }
+            }
+            w.deferred.clear();
+        }
+    }
+
+    // No other thread writes to nid while it is processed: forward edges
+    // come from lower levels, and back-edges are deferred.
+    void _process(Worker &w, NodeLoc nid) {
+        active[nid] = 0;
+        const auto &node = graph.node(nid);
+        auto &done_idx = kd.done_idx(nid);
+
+        LetterLoc loc = lloc.compress(NodePos(nid, 0));
+
+        if (node.seg.size() >= Kmer::K) {
+            Kmer kmer;
+            for (; done_idx < kd.num_kmers(nid); ++done_idx) {
+                kmer = kd.get(nid, done_idx);
+                if (kmer.is_complete())
+                    _emit(w, kmer, loc);
+                _walk_node(w, kmer, node.seg, loc, 1, Kmer::K);
+            }
+            _walk_node(w, kmer, node.seg, loc, Kmer::K, node.seg.size());
+            kmer.push_back(node.seg.back());
+            _push_neighbours(w, kmer, nid);
+        } else {
+            for (; done_idx < kd.num_kmers(nid); ++done_idx) {
+                Kmer kmer = kd.get(nid, done_idx);
+                if (kmer.is_complete())
+                    _emit(w, kmer, loc);
+                _walk_node(w, kmer, node.seg, loc, 1, node.seg.size());
+                kmer.push_back(node.seg.back());
+                _push_neighbours(w, kmer, nid);
+            }
+        }
+    }
+
+    void _walk_node(Worker &w, Kmer &kmer, const Str &seg,
+            LetterLoc loc, NodeLen start, NodeLen end) {
+        KmerRoller<Kmer>::walk(kmer, seg, start, end,
+                [&](const Kmer &k, NodeLen i) { _emit(w, k, loc + i); });
+    }
+
+    void _push_neighbours(Worker &w, const Kmer &kmer, NodeLoc nid) {
+        for (const auto &fwd : graph.forward_from(nid)) {
+            if (_is_backedge(nid, fwd.node_id)) {
+                w.deferred.emplace_back(fwd.node_id, kmer);
+                continue;
+            }
+            auto lk = locks.lock(fwd.node_id);
+            if (!kd.exists(fwd.node_id, kmer)) {
+                kd.add_kmer(fwd.node_id, kmer);
+                if (!active[fwd.node_id]) {
+                    active[fwd.node_id] = 1;
+                    w.activated.push_back(fwd.node_id);
+                }
+            }
+        }
+    }
+
+    void _emit(Worker &w, const Kmer &kmer, LetterLoc loc) {
+        if constexpr (concurrent_pairs_sink_v<VectorPairs>) {
+            pairs.emplace_back(kmer, loc);
+        } else {
+            w.out.emplace_back(kmer, loc);
+            if (w.out.size() >= FLUSH_SIZE)
+                _flush(w);
+        }
+    }
+
+    void _flush(Worker &w) {
+        {
+            std::lock_guard<std::mutex> lk(pairs_mtx);
+            for (const auto &p : w.out)
+                pairs.emplace_back(p.first, p.second);
+        }
+        w.out.clear();
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __TRIE_BUILDER_NBFS_PAR_H__ */
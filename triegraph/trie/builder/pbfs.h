@@ -6,6 +6,9 @@
 #ifndef __TRIE_BUILDER_PBFS_H__
 #define __TRIE_BUILDER_PBFS_H__
 
+#include "triegraph/graph/complexity_estimator.h"
+#include "triegraph/graph/top_order.h"
+#include "triegraph/trie/kmer_roller.h"
 #include "triegraph/util/logger.h"
 
 #include <vector>
@@ -21,6 +24,7 @@ struct TrieBuilderPBFS {
     using VectorPairs = VectorPairs_;
     using NodePos = LetterLocData::NodePos;
     using LetterLoc = LetterLocData::LetterLoc;
+    using klen_type = Kmer::klen_type;
     using Self = TrieBuilderPBFS;
 
     const Graph &graph;
@@ -35,14 +39,37 @@ struct TrieBuilderPBFS {
     Self &operator= (const Self &) = delete;
     Self &operator= (Self &&) = delete;
 
+    /**
+     * With region_max_kmers set, the trie depth is picked per node from the
+     * ComplexityEstimator, so that about region_max_kmers kmers end at each
+     * node's start. A kmer stops growing once it crosses into a node with a
+     * smaller depth, so dense regions produce inner kmers (needs allow_inner),
+     * while kmers inside a node are always complete.
+     */
     struct Settings {
         static constexpr u32 default_cut_early_threashold = 128u;
+        static constexpr u32 default_region_min_depth = 1u;
+        static constexpr u32 default_region_backedge_init = 4u;
+        static constexpr u32 default_region_backedge_max_trav = 2u;
         u32 cut_early_threshold = default_cut_early_threashold;
+        u32 region_max_kmers = 0; // 0 -- fixed depth
+        u32 region_min_depth = default_region_min_depth;
+        u32 region_backedge_init = default_region_backedge_init;
+        u32 region_backedge_max_trav = default_region_backedge_max_trav;
 
         static Settings from_config(const auto &cfg) {
             return {
                 .cut_early_threshold = cfg.template get_or<u32>(
-                        "trie-builder-pbfs-cut-early-threshold", default_cut_early_threashold)
+                        "trie-builder-pbfs-cut-early-threshold", default_cut_early_threashold),
+                .region_max_kmers = cfg.template get_or<u32>(
+                        "trie-builder-pbfs-region-max-kmers", 0u),
+                .region_min_depth = cfg.template get_or<u32>(
+                        "trie-builder-pbfs-region-min-depth", default_region_min_depth),
+                .region_backedge_init = cfg.template get_or<u32>(
+                        "trie-builder-pbfs-region-backedge-init", default_region_backedge_init),
+                .region_backedge_max_trav = cfg.template get_or<u32>(
+                        "trie-builder-pbfs-region-backedge-max-trav",
+                        default_region_backedge_max_trav),
             };
         }
     } settings_;
@@ -52,6 +79,8 @@ struct TrieBuilderPBFS {
 
     void compute_pairs(std::ranges::input_range auto&& starts) {
         auto scope = Logger::get().begin_scoped("pbfs builder");
+        if (settings_.region_max_kmers != 0)
+            _compute_depths();
         for (const auto &start: starts) {
             _bfs(start, settings_.cut_early_threshold);
         }
@@ -70,31 +99,51 @@ struct TrieBuilderPBFS {
         Stats() : short_kmer(0), short_next(0), fast_split(0), normal(0) {}
     } stats;
 
-    std::vector<std::pair<Kmer, NodePos>> a, b;
+    std::vector<klen_type> node_depth; // empty -- Kmer::K everywhere
+
+    void _compute_depths() {
+        using TopOrder = triegraph::TopOrder<Graph>;
+        using CE = ComplexityEstimator<Graph, TopOrder, typename Kmer::Holder>;
+        auto top_ord = typename TopOrder::Builder(graph).build();
+        auto depths = CE(graph, top_ord, Kmer::K,
+                settings_.region_backedge_init,
+                settings_.region_backedge_max_trav).compute().get_depths(
+                    settings_.region_max_kmers, settings_.region_min_depth);
+        node_depth.assign(depths.begin(), depths.end());
+    }
+
+    klen_type _depth(typename Graph::NodeLoc nid) const {
+        return node_depth.empty() ? Kmer::K : node_depth[nid];
+    }
+
+    struct Item {
+        Kmer kmer;
+        NodePos np;
+        klen_type cap;
+    };
+    std::vector<Item> a, b;
     void _bfs(NodePos start, u32 cut_early_threshold) {
 
         {
             auto &node = graph.node(start.node);
             if (start.pos + Kmer::K + 1 < node.seg.size()) {
-                Kmer kmer;
-                std::ranges::copy(
-                        node.seg.get_view(start.pos, Kmer::K),
-                        std::back_inserter(kmer));
+                Kmer kmer = Kmer::empty();
+                KmerRoller<Kmer>::append(kmer, node.seg, start.pos, Kmer::K);
                 pairs.emplace_back(kmer, lloc.compress(
                             NodePos(start.node, start.pos+Kmer::K)));
                 ++ stats.short_kmer;
                 return;
             }
+        }
+        // the depth limits only kick in when crossing into another node
+        if (node_depth.empty()) {
+            auto &node = graph.node(start.node);
             auto left = node.seg.size() - start.pos;
             if (auto nxt = graph.forward_one(start.node);
                     nxt && Kmer::K - left < graph.node(*nxt).seg.size()) {
-                Kmer kmer;
-                std::ranges::copy(
-                        node.seg.get_view(start.pos, left),
-                        std::back_inserter(kmer));
-                std::ranges::copy(
-                        graph.node(*nxt).seg.get_view(0, Kmer::K - left),
-                        std::back_inserter(kmer));
+                Kmer kmer = Kmer::empty();
+                KmerRoller<Kmer>::append(kmer, node.seg, start.pos, left);
+                KmerRoller<Kmer>::append(kmer, graph.node(*nxt).seg, 0, Kmer::K - left);
                 pairs.emplace_back(kmer, lloc.compress(
                             NodePos(*nxt, Kmer::K - left)));
                 ++ stats.short_next;
@@ -105,15 +154,11 @@ struct TrieBuilderPBFS {
                 if (Kmer::K - left >= fwd.seg.size())
                     fast_split = false;
             if (fast_split) {
-                Kmer kmer;
-                std::ranges::copy(
-                        node.seg.get_view(start.pos, left),
-                        std::back_inserter(kmer));
+                Kmer kmer = Kmer::empty();
+                KmerRoller<Kmer>::append(kmer, node.seg, start.pos, left);
                 for (const auto &fwd : graph.forward_from(start.node)) {
                     Kmer tmp = kmer;
-                    std::ranges::copy(
-                            fwd.seg.get_view(0, Kmer::K - left),
-                            std::back_inserter(tmp));
+                    KmerRoller<Kmer>::append(tmp, fwd.seg, 0, Kmer::K - left);
                     pairs.emplace_back(tmp, lloc.compress(
                                 NodePos(fwd.node_id, Kmer::K - left)));
                 }
@@ -128,23 +173,29 @@ struct TrieBuilderPBFS {
         // b.reserve(cut_early_threshold);
         a.resize(0);
 
-        std::vector<std::pair<Kmer, NodePos>> *crnt_q = &a, *next_q = &b;
+        std::vector<Item> *crnt_q = &a, *next_q = &b;
 
-        crnt_q->emplace_back(Kmer::empty(), start);
-        typename Kmer::klen_type crnt_lvl;
+        crnt_q->push_back({ Kmer::empty(), start, Kmer::K });
+        klen_type crnt_lvl;
         for (crnt_lvl = 0;
                 crnt_lvl < Kmer::K &&
                     (cut_early_threshold == 0 || crnt_q->size() < cut_early_threshold);
                 ++crnt_lvl) {
             next_q->resize(0);
-            for (const auto &[kmer, np] : *crnt_q) {
+            for (const auto &item : *crnt_q) {
+                if (crnt_lvl >= item.cap) {
+                    next_q->push_back(item);
+                    continue;
+                }
+                const auto &[kmer, np, cap] = item;
                 Kmer nkmer = kmer;
                 nkmer.push_back(graph.node(np.node).seg[np.pos]);
                 if (np.pos + 1 < graph.node(np.node).seg.size()) {
-                    next_q->emplace_back(nkmer, NodePos(np.node, np.pos+1));
+                    next_q->push_back({ nkmer, NodePos(np.node, np.pos+1), cap });
                 } else {
                     for (const auto &fw : graph.forward_from(np.node)) {
-                        next_q->emplace_back(nkmer, NodePos(fw.node_id, 0));
+                        next_q->push_back({ nkmer, NodePos(fw.node_id, 0),
+                                std::min(cap, _depth(fw.node_id)) });
                     }
                 }
             }
@@ -153,7 +204,7 @@ struct TrieBuilderPBFS {
 
         // pairs.reserve(pairs.size() + crnt_q->size());
         auto conv_np = [&](const auto &p) { return std::make_pair(
-                p.first, lloc.compress(p.second)); };
+                p.kmer, lloc.compress(p.np)); };
         std::ranges::copy(*crnt_q | std::ranges::views::transform(conv_np),
                 std::back_inserter(pairs));
     }
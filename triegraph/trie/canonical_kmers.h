@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __CANONICAL_KMERS_H__
+#define __CANONICAL_KMERS_H__
+
+#include "triegraph/util/util.h"
+#include "triegraph/util/vector_pairs.h"
+
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+namespace triegraph {
+
+/**
+ * Canonical kmer mode, for graphs built with add_reverse_complement.
+ *
+ * Node n^1 spells the reverse complement of node n, so a kmer fully inside n
+ * has a mirror occurrence (its reverse complement) inside n^1. For a pair
+ * (kmer, loc) with loc = (n, p), the kmer is fully inside n iff p >= K. When
+ * p > K, the mirror is again such a pair (at n^1), because the letter before
+ * the kmer mirrors to the letter after it. Of these pairs only the ones with
+ * a canonical kmer (kmer <= rev_comp(kmer)) are stored, the rest are
+ * recovered by mirroring the locations of rev_comp(kmer).
+ *
+ * Kmers crossing nodes (and inner kmers) are always stored: which location
+ * their mirror ends at depends on the path, not just on loc.
+ */
+template <typename Kmer_, typename LetterLocData_>
+struct CanonicalKmers {
+    using Kmer = Kmer_;
+    using LetterLocData = LetterLocData_;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using NodePos = LetterLocData::NodePos;
+
+    /** a kmer ending before np is inside np.node, and so is its mirror */
+    static bool inside(NodePos np) { return np.pos > Kmer::K; }
+
+    /** loc after the mirror of the kmer ending before np (np is inside) */
+    static LetterLoc mirror(NodePos np, const LetterLocData &lloc) {
+        return lloc.compress(NodePos(np.node, np.pos - Kmer::K - 1)
+                .reverse_in(lloc.node_len(np.node)));
+    }
+
+    static bool keep(const Kmer &kmer, LetterLoc loc, const LetterLocData &lloc) {
+        return !kmer.is_complete() || kmer.is_canonical() ||
+            !inside(lloc.expand(loc));
+    }
+};
+
+/**
+ * Pairs sink, that drops the pairs canonical mode can recover. It needs the
+ * builder to run from all locations, otherwise a dropped pair's mirror might
+ * never be emitted.
+ */
+template <typename Sink_, typename Kmer_, typename LetterLocData_>
+struct CanonicalPairsFilter {
+    using Sink = Sink_;
+    using Kmer = Kmer_;
+    using LetterLocData = LetterLocData_;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using value_type = std::pair<Kmer, LetterLoc>;
+    using Canonical = CanonicalKmers<Kmer, LetterLocData>;
+    static constexpr bool concurrent = concurrent_pairs_sink_v<Sink>;
+
+    Sink &sink;
+    const LetterLocData &lloc;
+
+    CanonicalPairsFilter(Sink &sink, const LetterLocData &lloc)
+        : sink(sink), lloc(lloc) {}
+
+    size_t size() const { return sink.size(); }
+    void reserve(size_t capacity) { sink.reserve(capacity); }
+    void set_order(auto o) { sink.set_order(o); }
+
+    void emplace_back(const Kmer &kmer, LetterLoc loc) {
+        if (Canonical::keep(kmer, loc, lloc))
+            sink.emplace_back(kmer, loc);
+    }
+
+    void push_back(const auto &p) { emplace_back(p.first, p.second); }
+};
+
+/**
+ * Locations of a kmer in canonical mode: the stored ones, followed by the
+ * mirrored inside locations of its reverse complement.
+ *
+ * Like iter_pair, can be walked directly with *, ++ and empty().
+ */
+template <typename Kmer_, typename LetterLocData_, typename ValuesView_>
+struct CanonicalT2GView : std::ranges::view_base {
+    using Kmer = Kmer_;
+    using LetterLocData = LetterLocData_;
+    using ValuesView = ValuesView_;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using Canonical = CanonicalKmers<Kmer, LetterLocData>;
+    using Self = CanonicalT2GView;
+
+    using value_type = LetterLoc;
+
+    ValuesView own, rc;
+    const LetterLocData *lloc = nullptr;
+    LetterLoc cur = 0;
+
+    CanonicalT2GView() {}
+    CanonicalT2GView(ValuesView own, ValuesView rc, const LetterLocData &lloc)
+        : own(own), rc(rc), lloc(&lloc)
+    {
+        _skip();
+    }
+
+    struct iterator {
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Self::value_type;
+
+        Self view;
+
+        value_type operator* () const { return *view; }
+        iterator &operator++ () { ++view; return *this; }
+        iterator operator++ (int) { iterator tmp = *this; ++view; return tmp; }
+        friend bool operator== (const iterator &it, std::default_sentinel_t) {
+            return it.view.empty();
+        }
+    };
+
+    iterator begin() const { return { *this }; }
+    std::default_sentinel_t end() const { return {}; }
+
+    value_type operator* () const { return cur; }
+    Self &operator++ () {
+        if (!own.empty())
+            ++own;
+        else
+            ++rc;
+        _skip();
+        return *this;
+    }
+    Self operator++ (int) { Self tmp = *this; ++(*this); return tmp; }
+    bool empty() const { return own.empty() && rc.empty(); }
+
+private:
+    void _skip() {
+        if (!own.empty()) {
+            cur = *own;
+            return;
+        }
+        for (; !rc.empty(); ++rc) {
+            auto np = lloc->expand(*rc);
+            if (Canonical::inside(np)) {
+                cur = Canonical::mirror(np, *lloc);
+                return;
+            }
+        }
+    }
+};
+
+/**
+ * Kmers ending at a location in canonical mode. An inside location has
+ * exactly one such kmer, if it is not stored, it is the reverse complement of
+ * the one at the mirror location.
+ */
+template <typename Kmer_, typename ValuesView_>
+struct CanonicalG2TView : std::ranges::view_base {
+    using Kmer = Kmer_;
+    using ValuesView = ValuesView_;
+    using Self = CanonicalG2TView;
+
+    using value_type = Kmer;
+
+    ValuesView stored;
+    Kmer single = {};
+    bool has_single = false;
+
+    CanonicalG2TView() {}
+    CanonicalG2TView(ValuesView stored) : stored(stored) {}
+    CanonicalG2TView(Kmer single) : single(single), has_single(true) {}
+
+    struct iterator {
+        using iterator_concept = std::input_iterator_tag;
+        using difference_type = std::ptrdiff_t;
+        using value_type = Self::value_type;
+
+        Self view;
+
+        value_type operator* () const { return *view; }
+        iterator &operator++ () { ++view; return *this; }
+        iterator operator++ (int) { iterator tmp = *this; ++view; return tmp; }
+        friend bool operator== (const iterator &it, std::default_sentinel_t) {
+            return it.view.empty();
+        }
+    };
+
+    iterator begin() const { return { *this }; }
+    std::default_sentinel_t end() const { return {}; }
+
+    value_type operator* () const { return has_single ? single : *stored; }
+    Self &operator++ () {
+        if (has_single)
+            has_single = false;
+        else
+            ++stored;
+        return *this;
+    }
+    Self operator++ (int) { Self tmp = *this; ++(*this); return tmp; }
+    bool empty() const { return !has_single && stored.empty(); }
+};
+
+} /* namespace triegraph */
+
+#endif /* __CANONICAL_KMERS_H__ */
@@ -126,6 +126,17 @@ struct DKmer {
         return beg[sz] + (data & _kmer_mask(K-sz));
     }
 
+    /** reverse complement, only for complete kmers */
+    Self rev_comp() const {
+        Holder src = data, res = 0;
+        for (klen_type i = 0; i < K; ++i) {
+            res = res << Letter::bits | ((src & Letter::mask) ^ Letter::mask);
+            src >>= Letter::bits;
+        }
+        return { res | ON_MASK };
+    }
+    bool is_canonical() const { return data <= rev_comp().data; }
+
     static Self empty() { return { EMPTY }; }
     static Self from_str(std::basic_string<typename Letter::Human> s) {
         auto kmer = Self::empty();
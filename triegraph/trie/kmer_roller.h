@@ -0,0 +1,101 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __KMER_ROLLER_H__
+#define __KMER_ROLLER_H__
+
+#include "triegraph/util/util.h"
+
+namespace triegraph {
+
+/**
+ * Fast kmer extraction from packed strings.
+ *
+ * Kmer::push_back keeps track of the kmer length, which is wasted work once
+ * the kmer is complete. After that, every next kmer is just
+ * (prev << bits | letter) & KMER_MASK. Letters are read a whole Str word at a
+ * time, and shifted out of a register, instead of indexing every letter.
+ */
+template <typename Kmer_>
+struct KmerRoller {
+    using Kmer = Kmer_;
+    using Holder = Kmer::Holder;
+    using Letter = Kmer::Letter;
+    using klen_type = Kmer::klen_type;
+
+    /** sequential letter reader over the words of a Str */
+    template <typename Str>
+    struct Letters {
+        using SHolder = Str::Holder;
+        static constexpr u32 PER_WORD = Str::letters_per_store;
+
+        const SHolder *word;
+        SHolder cur;
+        u32 left;
+
+        Letters(const Str &s, u64 pos)
+            : word(s.data + pos / PER_WORD), left(PER_WORD - pos % PER_WORD) {
+            cur = *word >> (pos % PER_WORD) * Letter::bits;
+        }
+
+        Holder next() {
+            if (left == 0) {
+                cur = *++word;
+                left = PER_WORD;
+            }
+            Holder l = cur & Letter::mask;
+            cur >>= Letter::bits;
+            --left;
+            return l;
+        }
+    };
+
+    /** append seg[pos, pos+n) to kmer */
+    template <typename Str>
+    static void append(Kmer &kmer, const Str &seg, u64 pos, u64 n) {
+        if (n == 0)
+            return;
+        klen_type len = kmer.get_len();
+        if (len + n < Kmer::K) {
+            Letters<Str> ls(seg, pos);
+            for (u64 i = 0; i < n; ++i)
+                kmer.push_back(Letter(ls.next()));
+            return;
+        }
+        // the result is complete, so no length bookkeeping
+        Holder data = kmer.data & Kmer::_kmer_mask(Kmer::K - len);
+        Letters<Str> ls(seg, pos);
+        for (u64 i = 0; i < n; ++i)
+            data = data << Letter::bits | ls.next();
+        kmer.data = (data & Kmer::KMER_MASK) | Kmer::ON_MASK;
+    }
+
+    /**
+     * Push seg[i-1] for i in [start, end), calling emit(kmer, i) for every
+     * complete kmer.
+     */
+    template <typename Str>
+    static void walk(Kmer &kmer, const Str &seg, u64 start, u64 end,
+            auto &&emit) {
+        if (start >= end)
+            return;
+        Letters<Str> ls(seg, start - 1);
+        u64 i = start;
+        for (; i < end && !kmer.is_complete(); ++i) {
+            kmer.push_back(Letter(ls.next()));
+            if (kmer.is_complete())
+                emit(kmer, i);
+        }
+        for (; i < end; ++i) {
+            kmer.data = ((kmer.data << Letter::bits | ls.next()) &
+                    Kmer::KMER_MASK) | Kmer::ON_MASK;
+            emit(kmer, i);
+        }
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __KMER_ROLLER_H__ */
@@ -0,0 +1,140 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __SAMPLED_LOOKUP_H__
+#define __SAMPLED_LOOKUP_H__
+
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Lookup in a sampled TrieData -- one built only from SparseStarts every N
+ * positions, instead of from all locations.
+ *
+ * Any N consecutive positions of a path contain a sampled start, so an
+ * occurrence of a query q (of at least K+N-1 letters) has a stored kmer
+ * q[i, i+K) for some i < N. From each stored hit, the graph is walked back
+ * i letters (to where q[0, K) ends), and K more letters to check q[0, K).
+ * The rest of q is checked forward from the hit.
+ *
+ * Kmers ending at the last letter of a sink node have no location after them,
+ * and aren't stored. An occurrence whose only sampled kmer is such can't be
+ * found (not an issue with add_extends, where sinks are extended).
+ *
+ * Kmers are complete and stored as built, so canonical mode (which needs
+ * all locations) is not supported.
+ */
+template <typename Graph_, typename LetterLocData_, typename TrieData_>
+struct SampledLookup {
+    using Graph = Graph_;
+    using LetterLocData = LetterLocData_;
+    using TrieData = TrieData_;
+    using Kmer = TrieData::Kmer;
+    using Str = Graph::Str;
+    using NodePos = LetterLocData::NodePos;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using Self = SampledLookup;
+
+    static_assert(!TrieData::canonical);
+
+    const Graph &graph;
+    const LetterLocData &lloc;
+    const TrieData &td;
+    u32 every;
+
+    SampledLookup(const Graph &graph, const LetterLocData &lloc,
+            const TrieData &td, u32 every)
+        : graph(graph), lloc(lloc), td(td), every(every) {}
+
+    /**
+     * Locations right after q[0, K), for the occurrences of (the whole) q in
+     * the graph. With fewer than K+N-1 letters some might be missed.
+     */
+    std::vector<LetterLoc> locations_for(const Str::View &query) const {
+        std::vector<LetterLoc> res;
+        if (query.size() < Kmer::K)
+            return res;
+        u64 shifts = std::min(u64(every), u64(query.size() - Kmer::K + 1));
+        for (u64 i = 0; i < shifts; ++i) {
+            auto kmer = Kmer::from_sv(typename Str::View(
+                        query.base, query.offset + i, Kmer::K));
+            for (LetterLoc loc : td.t2g_values_for(kmer)) {
+                auto np = lloc.expand(loc);
+                if (_fwd_match(query, Kmer::K + i, np))
+                    _walk(query, Kmer::K + i, Kmer::K, np, res);
+            }
+        }
+        std::ranges::sort(res);
+        res.erase(std::unique(res.begin(), res.end()), res.end());
+        return res;
+    }
+
+private:
+    // walk back over q[k_end, end) from np, where q[0, k_end) should end
+    void _walk(const Str::View &query, u64 end, u64 k_end, NodePos np,
+            std::vector<LetterLoc> &res) const {
+        if (end == k_end) {
+            if (_match(query, end, np))
+                res.push_back(lloc.compress(np));
+            return;
+        }
+        _prev(np, [&](NodePos prev, auto letter) {
+            if (letter == query[end - 1])
+                _walk(query, end - 1, k_end, prev, res);
+        });
+    }
+
+    // is there a path spelling q[0, end) ending at np
+    bool _match(const Str::View &query, u64 end, NodePos np) const {
+        if (end == 0)
+            return true;
+        bool any = false;
+        _prev(np, [&](NodePos prev, auto letter) {
+            if (!any && letter == query[end - 1])
+                any = _match(query, end - 1, prev);
+        });
+        return any;
+    }
+
+    // is there a path spelling q[from, end) starting at np
+    bool _fwd_match(const Str::View &query, u64 from, NodePos np) const {
+        for (; from < query.size(); ++from) {
+            const auto &seg = graph.node(np.node).seg;
+            if (seg[np.pos] != query[from])
+                return false;
+            if (from + 1 == query.size())
+                return true;
+            if (np.pos + 1 < seg.size()) {
+                ++np.pos;
+            } else {
+                for (const auto &fwd : graph.forward_from(np.node))
+                    if (_fwd_match(query, from + 1, NodePos(fwd.node_id, 0)))
+                        return true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // calls cb(prev, letter) for the letters right before np
+    void _prev(NodePos np, auto &&cb) const {
+        if (np.pos > 0) {
+            cb(NodePos(np.node, np.pos - 1), graph.node(np.node).seg[np.pos - 1]);
+        } else {
+            for (const auto &bwd : graph.backward_from(np.node)) {
+                auto len = bwd.seg.size();
+                cb(NodePos(bwd.node_id, len - 1), bwd.seg[len - 1]);
+            }
+        }
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __SAMPLED_LOOKUP_H__ */
@@ -6,8 +6,10 @@
 #ifndef __TRIE_DATA_H__
 #define __TRIE_DATA_H__
 
+#include "triegraph/trie/canonical_kmers.h"
 #include "triegraph/trie/kmer_codec.h"
 #include "triegraph/trie/trie_presence.h"
+#include "triegraph/util/binary_io.h"
 #include "triegraph/util/compact_vector.h"
 #include "triegraph/util/sorted_vector.h"
 #include "triegraph/util/logger.h"
@@ -16,6 +18,7 @@
 #include "triegraph/util/util.h"
 #include "triegraph/util/vector_pairs.h"
 
+#include <bit>
 #include <type_traits>
 #include <utility>
 #include <algorithm>
@@ -24,6 +27,7 @@
 #include <iterator>
 #include <ranges>
 #include <functional>
+#include <string>
 
 #include <assert.h>
 
@@ -35,7 +39,8 @@ template <typename Kmer_,
          bool allow_inner,
          typename T2GMap,
          typename G2TMap,
-         bool no_overhead_build = false>
+         bool no_overhead_build = false,
+         bool canonical_ = false>
 struct TrieData {
     using Kmer = Kmer_;
     using KHolder = Kmer::Holder;
@@ -44,9 +49,15 @@ struct TrieData {
     using VectorPairs = VectorPairs_;
 
     using KmerCodec = triegraph::KmerCodec<Kmer, typename Kmer::Holder, allow_inner>;
+    using Canonical = CanonicalKmers<Kmer, LetterLocData>;
+
+    /** store only canonical kmers, where the mirror can be recovered */
+    static constexpr bool canonical = canonical_;
 
     TrieData(VectorPairs pairs, const LetterLocData &letter_loc) {
-        if constexpr (no_overhead_build)
+        if constexpr (VectorPairs::impl == VectorPairsImpl::EXTERNAL)
+            init_external(std::move(pairs), letter_loc);
+        else if constexpr (no_overhead_build)
             init_no_overhead(std::move(pairs), letter_loc);
         else if constexpr (T2GMap::impl == MultimapImpl::DENSE &&
                 G2TMap::impl == MultimapImpl::DENSE &&
@@ -56,6 +67,13 @@ struct TrieData {
             init_simple(std::move(pairs), letter_loc);
     }
 
+    TrieData(T2GMap &&t2g, G2TMap &&g2t, const LetterLocData &letter_loc)
+        : trie2graph(std::move(t2g)),
+          graph2trie(std::move(g2t))
+    {
+        init_active(letter_loc);
+    }
+
     void init_simple(VectorPairs pairs, const LetterLocData &letter_loc) {
         auto &log = Logger::get();
 
@@ -88,7 +106,7 @@ struct TrieData {
                 )*/};
         log.end();
 
-        init_active();
+        init_active(letter_loc);
     }
 
     void init_dual_dense(VectorPairs pairs, const LetterLocData &letter_loc) {
@@ -100,37 +118,71 @@ struct TrieData {
 
         auto scope = log.begin_scoped("TrieData init_dual_dense");
 
-        log.begin("sort by rev + unique");
-        pairs.sort_by_rev().unique();
+        log.begin("sort by rev");
+        pairs.sort_by_rev();
         log.end();
 
+        // Duplicates are dropped while filling g2t, which also counts the
+        // locations per kmer. t2g is then the transpose of g2t: walking it in
+        // loc order and placing each loc at its kmer's next slot keeps the
+        // locs of a kmer sorted, so the pairs are never sorted by fwd.
+        using T2GStart = T2GMap::StartsContainer::value_type;
+        std::vector<T2GStart> kmer_pos(1);
+        auto &kmers = pairs.get_v1();
+        auto &locs = pairs.get_v2();
+        u64 num_pairs = 0;
+        SortedStartsBuilder<typename G2TMap::StartsContainer> g2t_starts;
+        typename G2TMap::ElemsContainer g2t_elems;
         {
-            auto scope = log.begin_scoped("g2t init");
-            auto starts = sorted_vector_from_elem_seq<typename G2TMap::StartsContainer>(
-                    pairs.get_v2());
-
-            typename G2TMap::ElemsContainer elems;
-            compact_vector_set_bits(elems, compact_vector_get_bits(pairs.get_v1()));
-            std::ranges::copy(pairs.get_v1(), std::back_inserter(elems));
-
-            graph2trie = G2TMap(std::move(starts), std::move(elems));
+            auto scope = log.begin_scoped("g2t init + unique");
+            compact_vector_set_bits(g2t_elems, compact_vector_get_bits(kmers));
+            g2t_elems.reserve(pairs.size());
+
+            auto kit = std::as_const(kmers).begin();
+            auto lit = std::as_const(locs).begin();
+            KHolder prev_kh = 0;
+            LetterLoc prev_loc = 0;
+            for (u64 i = 0, n = pairs.size(); i < n; ++i, ++kit, ++lit) {
+                KHolder kh = *kit;
+                LetterLoc loc = *lit;
+                if (num_pairs > 0 && loc == prev_loc && kh == prev_kh)
+                    continue;
+                prev_kh = kh;
+                prev_loc = loc;
+                g2t_starts.push(loc);
+                g2t_elems.push_back(kh);
+                locs[num_pairs++] = loc;
+                if (kh >= kmer_pos.size())
+                    kmer_pos.resize(kh + 1);
+                ++kmer_pos[kh];
+            }
+            pairs.take_v1();
+            locs.resize(num_pairs);
         }
 
-        log.begin("sort by fwd");
-        pairs.sort_by_fwd();
-        log.end();
-
         {
-            auto scope = log.begin_scoped("t2g init");
-            auto starts = sorted_vector_from_elem_seq<typename T2GMap::StartsContainer>(
-                    pairs.get_v1());
-
-            // TODO: Be more careful with taking v2, it could be different
-            // type/cfg
-            trie2graph = T2GMap(std::move(starts), pairs.take_v2());
+            auto scope = log.begin_scoped("t2g init (transpose)");
+            typename T2GMap::StartsContainer starts;
+            starts.reserve(kmer_pos.size());
+            T2GStart pos = 0;
+            for (auto &cnt : kmer_pos) {
+                starts.push_back(pos);
+                pos += std::exchange(cnt, pos);
+            }
+
+            typename T2GMap::ElemsContainer elems;
+            compact_vector_set_bits(elems, compact_vector_get_bits(locs));
+            elems.resize(num_pairs);
+            auto kit = std::as_const(g2t_elems).begin();
+            for (LetterLoc loc : std::as_const(locs))
+                elems[kmer_pos[*kit++]++] = loc;
+            pairs.take_v2();
+
+            trie2graph = T2GMap(std::move(starts), std::move(elems));
         }
+        graph2trie = G2TMap(g2t_starts.take(), std::move(g2t_elems));
 
-        init_active();
+        init_active(letter_loc);
     }
 
     void init_no_overhead(VectorPairs pairs, const LetterLocData &letter_loc) {
@@ -140,6 +192,12 @@ struct TrieData {
         static_assert(T2GMap::impl == MultimapImpl::DENSE);
         static_assert(G2TMap::impl == MultimapImpl::DENSE);
         static_assert(sizeof(KHolder) == sizeof(LetterLoc));
+        static_assert(std::is_same_v<typename VectorPairs::Column1,
+                typename G2TMap::ElemsContainer> &&
+                std::is_same_v<typename VectorPairs::Column2,
+                typename T2GMap::ElemsContainer>,
+                "pair columns are moved into TrieData, so VmVector backed "
+                "pairs (VP_VM_VECTOR) don't work with TD_ZERO_OVERHEAD");
 
         auto &log = Logger::get();
 
@@ -185,10 +243,209 @@ struct TrieData {
         graph2trie = { std::move(locs_beg), std::move(kmers) };
         log.end();
 
-        init_active();
+        init_active(letter_loc);
     }
 
-    void init_active() {
+    void init_external(VectorPairs pairs, const LetterLocData &letter_loc) {
+        static_assert(VectorPairs::impl == VectorPairsImpl::EXTERNAL);
+        static_assert(T2GMap::impl == MultimapImpl::DENSE);
+        static_assert(G2TMap::impl == MultimapImpl::DENSE);
+
+        auto &log = Logger::get();
+
+        auto scope = log.begin_scoped("TrieData init_external");
+
+        log.begin("sort by rev + unique");
+        pairs.sort_by_rev().unique();
+        log.end();
+
+        {
+            // pairs are merged from disk, so starts and elems are filled in
+            // a single pass
+            auto scope = log.begin_scoped("g2t init");
+            SortedStartsBuilder<typename G2TMap::StartsContainer> starts;
+            typename G2TMap::ElemsContainer elems;
+            compact_vector_set_bits(elems, log2_ceil(total_kmers()) + 1);
+            elems.reserve(pairs.size());
+            for (const auto &[loc, kmer] : pairs.rev_pairs()) {
+                starts.push(loc);
+                elems.push_back(kmer);
+            }
+            graph2trie = G2TMap(starts.take(), std::move(elems));
+        }
+
+        log.begin("sort by fwd");
+        pairs.sort_by_fwd();
+        log.end();
+
+        {
+            auto scope = log.begin_scoped("t2g init");
+            SortedStartsBuilder<typename T2GMap::StartsContainer> starts;
+            typename T2GMap::ElemsContainer elems;
+            compact_vector_set_bits(elems, log2_ceil(letter_loc.num_locations) + 1);
+            elems.reserve(pairs.size());
+            for (const auto &[kmer, loc] : pairs.fwd_pairs()) {
+                starts.push(kmer);
+                elems.push_back(loc);
+            }
+            trie2graph = T2GMap(starts.take(), std::move(elems));
+        }
+
+        init_active(letter_loc);
+    }
+
+    /**
+     * Pairs sink for counting_build: counts pairs per location (pass 1), or
+     * places each kmer in its location's slot of the g2t elems (pass 2).
+     */
+    struct CountingSink {
+        using T1 = VectorPairs::T1;
+        using T2 = LetterLoc;
+        using G2TStart = G2TMap::StartsContainer::value_type;
+        using G2TElems = G2TMap::ElemsContainer;
+
+        std::vector<G2TStart> &pos;
+        G2TElems *elems = nullptr;
+        u64 total = 0;
+        // order independent hash of the pairs
+        u64 pair_sum = 0;
+
+        size_t size() const { return total; }
+        void reserve(size_t) {}
+        void set_order(VectorPairsOrder) {}
+
+        void emplace_back(const T1 &kmer, LetterLoc loc) {
+            ++total;
+            pair_sum += mix64(loc ^ mix64(_to_int(kmer)));
+            if (elems == nullptr) {
+                ++pos[loc];
+                return;
+            }
+            // buckets are filled from the end, pos ends up at their starts
+            if (pos[loc] == 0)
+                throw "counting-build-pairs-mismatch";
+            (*elems)[--pos[loc]] = _to_int(kmer);
+        }
+        void push_back(const auto &p) { emplace_back(p.first, p.second); }
+
+    private:
+        static KHolder _to_int(const T1 &kmer) {
+            if constexpr (std::is_same_v<T1, Kmer>)
+                return KmerCodec::to_int(kmer);
+            else
+                return kmer;
+        }
+    };
+
+    /**
+     * Counting sort build, without a VectorPairs buffer or pair sorting.
+     *
+     * run_pairs(sink) emits all pairs into a CountingSink, and is called
+     * twice: the first pass counts pairs per location, the second scatters
+     * the kmers into the g2t elems. Both passes must emit the same pairs
+     * (in any order), which is checked with a hash of the pairs.
+     * Duplicates are dropped per location afterwards, and t2g is the
+     * transpose of g2t (see init_dual_dense).
+     *
+     * Peak memory is the index itself, plus duplicate pairs and a counter
+     * per location and per kmer.
+     */
+    static TrieData counting_build(auto &&run_pairs, const LetterLocData &letter_loc) {
+        static_assert(T2GMap::impl == MultimapImpl::DENSE);
+        static_assert(G2TMap::impl == MultimapImpl::DENSE);
+        using G2TStart = CountingSink::G2TStart;
+        using T2GStart = T2GMap::StartsContainer::value_type;
+
+        auto &log = Logger::get();
+
+        auto scope = log.begin_scoped("TrieData counting_build");
+
+        std::vector<G2TStart> loc_pos(letter_loc.num_locations);
+        u64 num_pairs, pair_sum;
+        {
+            auto scope = log.begin_scoped("count pairs per loc");
+            CountingSink sink { loc_pos };
+            run_pairs(sink);
+            num_pairs = sink.total;
+            pair_sum = sink.pair_sum;
+            // bucket ends
+            G2TStart pos = 0;
+            for (auto &cnt : loc_pos)
+                cnt = pos += cnt;
+        }
+
+        typename G2TMap::ElemsContainer g2t_elems;
+        {
+            auto scope = log.begin_scoped("scatter pairs");
+            compact_vector_set_bits(g2t_elems, std::min<u32>(
+                        std::bit_width(total_kmers()), sizeof(KHolder) * BITS_PER_BYTE));
+            g2t_elems.resize(num_pairs);
+            CountingSink sink { loc_pos, &g2t_elems };
+            run_pairs(sink);
+            // the same pairs fill the buckets exactly
+            if (sink.total != num_pairs || sink.pair_sum != pair_sum)
+                throw "counting-build-pairs-mismatch";
+        }
+
+        std::vector<T2GStart> kmer_pos(1);
+        SortedStartsBuilder<typename G2TMap::StartsContainer> g2t_starts;
+        {
+            // sort + unique each loc, in place, leaving loc_pos at the new
+            // starts
+            auto scope = log.begin_scoped("g2t unique");
+            std::vector<KHolder> buf;
+            u64 out = 0;
+            for (u64 loc = 0; loc < loc_pos.size(); ++loc) {
+                u64 beg = loc_pos[loc];
+                u64 end = loc + 1 < loc_pos.size() ? loc_pos[loc + 1] : num_pairs;
+                buf.clear();
+                for (u64 i = beg; i < end; ++i)
+                    buf.push_back(g2t_elems[i]);
+                std::ranges::sort(buf);
+                buf.erase(std::unique(buf.begin(), buf.end()), buf.end());
+                loc_pos[loc] = out;
+                for (KHolder kh : buf) {
+                    g2t_starts.push(loc);
+                    g2t_elems[out++] = kh;
+                    if (kh >= kmer_pos.size())
+                        kmer_pos.resize(kh + 1);
+                    ++kmer_pos[kh];
+                }
+            }
+            num_pairs = out;
+            g2t_elems.resize(num_pairs);
+        }
+
+        T2GMap t2g;
+        {
+            auto scope = log.begin_scoped("t2g init (transpose)");
+            typename T2GMap::StartsContainer starts;
+            starts.reserve(kmer_pos.size());
+            T2GStart pos = 0;
+            for (auto &cnt : kmer_pos) {
+                starts.push_back(pos);
+                pos += std::exchange(cnt, pos);
+            }
+
+            typename T2GMap::ElemsContainer elems;
+            compact_vector_set_bits(elems, std::max<u32>(1,
+                        std::bit_width(u64(letter_loc.num_locations))));
+            elems.resize(num_pairs);
+            for (u64 loc = 0; loc < loc_pos.size(); ++loc) {
+                u64 end = loc + 1 < loc_pos.size() ? loc_pos[loc + 1] : num_pairs;
+                for (u64 i = loc_pos[loc]; i < end; ++i)
+                    elems[kmer_pos[g2t_elems[i]]++] = LetterLoc(loc);
+            }
+            t2g = T2GMap(std::move(starts), std::move(elems));
+        }
+        { auto _ = std::move(loc_pos); }
+
+        return TrieData(std::move(t2g),
+                G2TMap(g2t_starts.take(), std::move(g2t_elems)),
+                letter_loc);
+    }
+
+    void init_active(const LetterLocData &letter_loc) {
         auto &log = Logger::get();
 
         auto scope = log.begin_scoped("construct active-trie O(n)");
@@ -196,7 +453,23 @@ struct TrieData {
             typename T2GMap::const_key_iterator,
             typename T2GMap::const_key_iterator,
             KmerCodec>;
-        active_trie = { key_iter_pair(trie2graph.keys()) };
+        if constexpr (canonical) {
+            // add the kmers, that are only present as mirrors
+            std::vector<Kmer> kmers;
+            for (Kmer kmer : key_iter_pair(trie2graph.keys())) {
+                kmers.push_back(kmer);
+                if (!kmer.is_complete() || kmer.rev_comp() == kmer)
+                    continue;
+                for (auto loc : t2g_values_for(kmer))
+                    if (Canonical::inside(letter_loc.expand(loc))) {
+                        kmers.push_back(kmer.rev_comp());
+                        break;
+                    }
+            }
+            active_trie = { kmers };
+        } else {
+            active_trie = { key_iter_pair(trie2graph.keys()) };
+        }
     }
 
     // auto _bsrch(const auto &arr, auto elem) {
@@ -212,6 +485,61 @@ struct TrieData {
     //     return beg;
     // }
 
+    static constexpr u64 FILE_MAGIC = 0x3130617464746774ull; // "tgtdta01"
+
+    // what the saved file must match, beyond what the containers check
+    struct FileHeader {
+        u64 magic = FILE_MAGIC;
+        u32 k = Kmer::K;
+        u32 kholder_bytes = sizeof(KHolder);
+        u32 letter_loc_bytes = sizeof(LetterLoc);
+        u32 flags = u32(allow_inner) | u32(canonical) << 1;
+        u64 num_locations = 0;
+        u64 num_nodes = 0;
+
+        bool operator== (const FileHeader &) const = default;
+    };
+
+    static FileHeader file_header(const LetterLocData &letter_loc) {
+        return {
+            .num_locations = letter_loc.num_locations,
+            .num_nodes = letter_loc.node_start.size(),
+        };
+    }
+
+    /**
+     * Dump t2g, g2t and the active trie to path. Arrays are aligned to
+     * BINARY_IO_SECTION_ALIGN, so load can map them.
+     */
+    void save(const std::string &path, const LetterLocData &letter_loc) const {
+        auto scope = Logger::get().begin_scoped("TrieData save");
+        BinaryWriter w(path);
+        w.write_pod(file_header(letter_loc));
+        binary_save(w, trie2graph);
+        binary_save(w, graph2trie);
+        binary_save(w, active_trie);
+        w.close();
+    }
+
+    /**
+     * Load what save wrote, for the same graph (and config). Containers over
+     * VmVector map their arrays from the file (no copy, pages are read on
+     * first touch), std::vector ones read each array at once.
+     */
+    static TrieData load(const std::string &path, const LetterLocData &letter_loc) {
+        auto scope = Logger::get().begin_scoped("TrieData load");
+        BinaryReader r(path);
+        if (!(r.read_pod<FileHeader>() == file_header(letter_loc)))
+            throw "trie-data-load-bad-header";
+        T2GMap t2g;
+        G2TMap g2t;
+        TriePresence<Kmer, allow_inner> active;
+        binary_load(r, t2g);
+        binary_load(r, g2t);
+        binary_load(r, active);
+        return TrieData(std::move(t2g), std::move(g2t), std::move(active));
+    }
+
     TrieData(const TrieData &) = delete;
     TrieData &operator= (const TrieData &) = delete;
     TrieData(TrieData &&) = default;
@@ -242,6 +570,45 @@ struct TrieData {
         return graph2trie.contains(loc);
     }
 
+    // The lloc overloads also return what canonical mode does not store.
+    // Without canonical mode they are the same as the above.
+    using t2g_lloc_view = std::conditional_t<canonical,
+          CanonicalT2GView<Kmer, LetterLocData, t2g_values_view>,
+          t2g_values_view>;
+    t2g_lloc_view t2g_values_for(Kmer kmer, const LetterLocData &lloc) const {
+        if constexpr (canonical) {
+            if (kmer.is_complete() && !kmer.is_canonical())
+                return { t2g_values_for(kmer), t2g_values_for(kmer.rev_comp()), lloc };
+            return { t2g_values_for(kmer), {}, lloc };
+        } else {
+            return t2g_values_for(kmer);
+        }
+    }
+    bool t2g_contains(Kmer kmer, const LetterLocData &lloc) const {
+        if constexpr (canonical)
+            return !t2g_values_for(kmer, lloc).empty();
+        else
+            return t2g_contains(kmer);
+    }
+
+    using g2t_lloc_view = std::conditional_t<canonical,
+          CanonicalG2TView<Kmer, g2t_values_view>,
+          g2t_values_view>;
+    g2t_lloc_view g2t_values_for(LetterLoc loc, const LetterLocData &lloc) const {
+        if constexpr (canonical) {
+            auto stored = g2t_values_for(loc);
+            if (stored.empty()) {
+                auto np = lloc.expand(loc);
+                if (Canonical::inside(np))
+                    if (auto rc = g2t_values_for(Canonical::mirror(np, lloc)); !rc.empty())
+                        return { (*rc).rev_comp() };
+            }
+            return { stored };
+        } else {
+            return g2t_values_for(loc);
+        }
+    }
+
     bool trie_inner_contains(Kmer kmer) const {
         return active_trie.contains(kmer);
     }
@@ -254,6 +621,14 @@ struct TrieData {
         }
     }
 
+    bool trie_contains(Kmer kmer, const LetterLocData &lloc) const {
+        if (kmer.is_complete()) {
+            return t2g_contains(kmer, lloc);
+        } else {
+            return trie_inner_contains(kmer);
+        }
+    }
+
     static constexpr u64 total_kmers() {
         if constexpr (allow_inner) {
             return Kmer::NUM_COMPRESSED;
@@ -300,6 +675,13 @@ struct TrieData {
     };
 
     Stats stats() const { return Stats(*this); }
+
+private:
+    TrieData(T2GMap &&t2g, G2TMap &&g2t, TriePresence<Kmer, allow_inner> &&active)
+        : trie2graph(std::move(t2g)),
+          graph2trie(std::move(g2t)),
+          active_trie(std::move(active))
+    {}
 };
 
 } /* namespace triegraph */
@@ -0,0 +1,202 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TRIE_DATA_RETARGET_H__
+#define __TRIE_DATA_RETARGET_H__
+
+#include "triegraph/trie/kmer_codec.h"
+#include "triegraph/trie/kmer_settings.h"
+#include "triegraph/trie/trie_data.h"
+#include "triegraph/util/compact_vector.h"
+#include "triegraph/util/logger.h"
+#include "triegraph/util/radix_sort.h"
+#include "triegraph/util/sorted_vector.h"
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Derive TrieData for a neighbouring trie depth from an existing one,
+ * instead of running the builder again.
+ *
+ * A pair (kmer, loc) at depth K+1 is a pair at depth K extended with the
+ * letter at loc (moving loc one letter forward, possibly into several
+ * nodes). A pair at depth K-1 is a pair at depth K with the first letter
+ * dropped, or a kmer starting at the beginning of a source node (nothing
+ * before it to drop). Each step is a pass over the pairs and a few radix
+ * sorts, so it is linear in the number of pairs.
+ *
+ * Leaf kmer codes are just the letters, so they are transformed directly,
+ * without decoding. This needs the old TrieData to hold all complete kmers
+ * ending at every location, so inner kmers (allow_inner) and canonical mode
+ * are not supported.
+ */
+template <typename Graph_, typename LetterLocData_, typename TrieData_>
+struct TrieDataRetarget {
+    using Graph = Graph_;
+    using LetterLocData = LetterLocData_;
+    using TrieData = TrieData_;
+    using Kmer = TrieData::Kmer;
+    using KHolder = Kmer::Holder;
+    using Letter = Kmer::Letter;
+    using NodePos = LetterLocData::NodePos;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using T2GMap = std::remove_cvref_t<decltype(TrieData::trie2graph)>;
+    using G2TMap = std::remove_cvref_t<decltype(TrieData::graph2trie)>;
+    using Self = TrieDataRetarget;
+
+    static_assert(T2GMap::impl == MultimapImpl::DENSE);
+    static_assert(G2TMap::impl == MultimapImpl::DENSE);
+    static_assert(std::is_same_v<typename TrieData::KmerCodec,
+            KmerCodec<Kmer, KHolder, false>>);
+    static_assert(!TrieData::canonical);
+
+    const Graph &graph;
+    const LetterLocData &lloc;
+
+    TrieDataRetarget(const Graph &graph, const LetterLocData &lloc)
+        : graph(graph), lloc(lloc) {}
+
+    TrieDataRetarget(const Self &) = delete;
+    TrieDataRetarget(Self &&) = delete;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = delete;
+
+    /** td must be built at the current Kmer::K, sets Kmer::K to trie_depth */
+    TrieData retarget(TrieData &&td, u16 trie_depth) {
+        auto scope = Logger::get().begin_scoped("TrieData retarget");
+        while (Kmer::K != trie_depth) {
+            td = Kmer::K < trie_depth ? grow(std::move(td)) : shrink(std::move(td));
+        }
+        return std::move(td);
+    }
+
+    /** K -> K+1 */
+    TrieData grow(TrieData &&td) {
+        auto &log = Logger::get();
+        auto old_k = Kmer::K;
+        _set_depth(old_k + 1);
+
+        log.begin("extend pairs");
+        pairs.clear();
+        for (LetterLoc loc = 0; loc < lloc.num_locations; ++loc) {
+            auto np = lloc.expand(loc);
+            const auto &seg = graph.node(np.node).seg;
+            KHolder letter = seg[np.pos].data;
+            auto emit = [&](LetterLoc nloc) {
+                for (auto kh : td.graph2trie.values_for(loc))
+                    pairs.emplace_back(nloc, KHolder(kh) << Letter::bits | letter);
+            };
+            if (np.pos + 1 < seg.size()) {
+                emit(loc + 1);
+            } else {
+                for (const auto &fwd : graph.forward_from(np.node))
+                    emit(lloc.compress(NodePos(fwd.node_id, 0)));
+            }
+        }
+        log.end();
+        return _finish(std::move(td));
+    }
+
+    /** K -> K-1 */
+    TrieData shrink(TrieData &&td) {
+        auto &log = Logger::get();
+        auto old_k = Kmer::K;
+        if (old_k <= 1)
+            throw "retarget-trie-depth-too-low";
+        _set_depth(old_k - 1);
+
+        log.begin("drop first letter");
+        pairs.clear();
+        KHolder mask = (KHolder(1) << (old_k - 1) * Letter::bits) - 1;
+        for (LetterLoc loc = 0; loc < lloc.num_locations; ++loc)
+            for (auto kh : td.graph2trie.values_for(loc))
+                pairs.emplace_back(loc, KHolder(kh) & mask);
+        log.end().begin("source kmers");
+        for (typename Graph::NodeLoc nid = 0; nid < graph.num_nodes(); ++nid)
+            if (graph.backward_from(nid).empty())
+                _fwd(NodePos(nid, 0), 0, 0);
+        log.end();
+        return _finish(std::move(td));
+    }
+
+private:
+    // (loc, kmer) pairs at the new depth
+    std::vector<std::pair<LetterLoc, KHolder>> pairs;
+
+    void _set_depth(u16 trie_depth) {
+        Kmer::set_settings({ .trie_depth = trie_depth, .on_mask = Kmer::ON_MASK });
+    }
+
+    // np is the location of the next letter, depth letters are in raw
+    void _fwd(NodePos np, u32 depth, KHolder raw) {
+        if (depth == Kmer::K) {
+            pairs.emplace_back(lloc.compress(np), raw);
+            return;
+        }
+        const auto &seg = graph.node(np.node).seg;
+        raw = raw << Letter::bits | seg[np.pos].data;
+        if (np.pos + 1 < seg.size()) {
+            _fwd(NodePos(np.node, np.pos + 1), depth + 1, raw);
+        } else {
+            for (const auto &fwd : graph.forward_from(np.node))
+                _fwd(NodePos(fwd.node_id, 0), depth + 1, raw);
+        }
+    }
+
+    TrieData _finish(TrieData &&td) {
+        auto &log = Logger::get();
+        // free the old maps before building the new ones
+        { auto _ = std::move(td); }
+
+        u32 kmer_bits = Kmer::K * Letter::bits;
+        u32 loc_bits = log2_ceil(lloc.num_locations) + 1;
+
+        log.begin("sort by loc");
+        radix_sort(pairs, [](const auto &p) { return p.second; }, kmer_bits);
+        radix_sort(pairs, [](const auto &p) { return p.first; }, loc_bits);
+        pairs.erase(std::unique(pairs.begin(), pairs.end()), pairs.end());
+
+        log.end().begin("build g2t");
+        SortedStartsBuilder<typename G2TMap::StartsContainer> g2t_starts;
+        typename G2TMap::ElemsContainer g2t_elems;
+        compact_vector_set_bits(g2t_elems, log2_ceil(TrieData::total_kmers()) + 1);
+        g2t_elems.reserve(pairs.size());
+        for (const auto &[loc, kh] : pairs) {
+            g2t_starts.push(loc);
+            g2t_elems.push_back(kh);
+        }
+
+        log.end().begin("build t2g");
+        // stable, so locations stay sorted within a kmer
+        radix_sort(pairs, [](const auto &p) { return p.second; }, kmer_bits);
+        SortedStartsBuilder<typename T2GMap::StartsContainer> t2g_starts;
+        typename T2GMap::ElemsContainer t2g_elems;
+        compact_vector_set_bits(t2g_elems, loc_bits);
+        t2g_elems.reserve(pairs.size());
+        for (const auto &[loc, kh] : pairs) {
+            t2g_starts.push(kh);
+            t2g_elems.push_back(loc);
+        }
+        log.end();
+        log.log("depth", Kmer::K, "pairs", pairs.size());
+
+        pairs.clear();
+        pairs.shrink_to_fit();
+        return TrieData(
+                T2GMap(t2g_starts.take(), std::move(t2g_elems)),
+                G2TMap(g2t_starts.take(), std::move(g2t_elems)),
+                lloc);
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __TRIE_DATA_RETARGET_H__ */
@@ -0,0 +1,261 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __TRIE_DATA_UPDATER_H__
+#define __TRIE_DATA_UPDATER_H__
+
+#include "triegraph/trie/trie_data.h"
+#include "triegraph/util/compact_vector.h"
+#include "triegraph/util/logger.h"
+#include "triegraph/util/sorted_vector.h"
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Patch TrieData after a local graph edit, instead of rebuilding it.
+ *
+ * The new graph must keep all old nodes (same ids and lengths), so old
+ * locations stay valid. New nodes come after the old ones. Edges may be added
+ * or removed freely, as long as both ends of every edited edge, are listed as
+ * edited nodes (new nodes are always considered edited).
+ *
+ * Extend nodes (add_extends) come after all original nodes, so they shift
+ * when nodes are added. They are sinks, so only kmers ending in them go
+ * through them: the old ones are dropped, and all new ones are recomputed.
+ *
+ * A pair (kmer, loc) only changes if the kmer path ending at loc crosses an
+ * edited node. Such locs (dirty) are at most K letters after an edited node.
+ * For each dirty loc all kmers ending there are re-enumerated, by walking the
+ * new graph backwards (a mirrored BT). The rest of the pairs are copied over
+ * from the old TrieData, merging in the fresh ones.
+ *
+ * Only complete kmers are recomputed, so inner kmers (allow_inner) are not
+ * supported. In canonical mode the fresh pairs are filtered the same way the
+ * builders' are.
+ */
+template <typename Graph_, typename LetterLocData_, typename TrieData_>
+struct TrieDataUpdater {
+    using Graph = Graph_;
+    using LetterLocData = LetterLocData_;
+    using TrieData = TrieData_;
+    using Kmer = TrieData::Kmer;
+    using KHolder = Kmer::Holder;
+    using KmerCodec = TrieData::KmerCodec;
+    using Letter = Kmer::Letter;
+    using NodeLoc = Graph::NodeLoc;
+    using NodePos = LetterLocData::NodePos;
+    using NodeLen = LetterLocData::NodeLen;
+    using LetterLoc = LetterLocData::LetterLoc;
+    using T2GMap = std::remove_cvref_t<decltype(TrieData::trie2graph)>;
+    using G2TMap = std::remove_cvref_t<decltype(TrieData::graph2trie)>;
+    using Self = TrieDataUpdater;
+
+    static_assert(T2GMap::impl == MultimapImpl::DENSE);
+    static_assert(G2TMap::impl == MultimapImpl::DENSE);
+
+    const Graph &graph;
+    const LetterLocData &lloc;
+
+    TrieDataUpdater(const Graph &graph, const LetterLocData &lloc)
+        : graph(graph), lloc(lloc) {}
+
+    TrieDataUpdater(const Self &) = delete;
+    TrieDataUpdater(Self &&) = delete;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = delete;
+
+    TrieData update(TrieData &&td, const Graph &old_graph, const LetterLocData &old_lloc,
+            std::ranges::input_range auto &&edited_nodes) {
+        auto &log = Logger::get();
+        auto scope = log.begin_scoped("TrieData update");
+
+        old_nodes = old_graph.num_original_nodes();
+        old_end = _nodes_end(old_lloc, old_nodes);
+        _check_prefix(old_lloc);
+
+        log.begin("dirty locations");
+        _mark_dirty(std::forward<decltype(edited_nodes)>(edited_nodes));
+        log.end().begin("enumerate kmers");
+        _enumerate();
+        log.end().begin("merge g2t");
+        auto g2t = _merge_g2t(td);
+        log.end().begin("merge t2g");
+        auto t2g = _merge_t2g(td);
+        log.end();
+        log.log("dirty locs", num_dirty, "fresh pairs", fresh.size());
+
+        // free the old maps before building the trie presence
+        { auto _ = std::move(td); }
+        return TrieData(std::move(t2g), std::move(g2t), lloc);
+    }
+
+private:
+    // old original (non extend) nodes, and their locations' end
+    NodeLoc old_nodes = 0;
+    LetterLoc old_end = 0;
+    std::vector<bool> dirty;
+    LetterLoc num_dirty = 0;
+    // (loc, kmer) pairs for dirty locations, sorted and unique
+    std::vector<std::pair<LetterLoc, KHolder>> fresh;
+    std::vector<Letter> letters;
+
+    static LetterLoc _nodes_end(const LetterLocData &ll, NodeLoc n) {
+        return n < ll.node_start.size() ? ll.node_start[n] : ll.num_locations;
+    }
+
+    void _check_prefix(const LetterLocData &old_lloc) const {
+        if (old_nodes > graph.num_original_nodes() ||
+                !std::equal(old_lloc.node_start.begin(),
+                    old_lloc.node_start.begin() + old_nodes,
+                    lloc.node_start.begin()) ||
+                _nodes_end(lloc, old_nodes) != old_end)
+            throw "updated-graph-changes-old-nodes";
+    }
+
+    void _mark_dirty(std::ranges::input_range auto &&edited_nodes) {
+        dirty.assign(lloc.num_locations, false);
+        // the most letters left to mark when entering a node
+        std::vector<u64> best(graph.num_nodes(), 0);
+        std::vector<std::pair<NodeLoc, u64>> stack;
+
+        auto edit = [&](NodeLoc nid) {
+            // in-edge edits affect the first K letters, out-edge edits the
+            // first K letters after the node
+            stack.emplace_back(nid, u64(graph.node(nid).seg.size()) + Kmer::K);
+            if (graph.settings.add_reverse_complement)
+                stack.emplace_back(nid ^ 1, u64(graph.node(nid ^ 1).seg.size()) + Kmer::K);
+        };
+        for (NodeLoc nid : edited_nodes)
+            edit(nid);
+        // new nodes, and all extend nodes
+        for (NodeLoc nid = old_nodes; nid < graph.num_nodes(); ++nid)
+            edit(nid);
+
+        while (!stack.empty()) {
+            auto [nid, left] = stack.back();
+            stack.pop_back();
+            if (left <= best[nid])
+                continue;
+            best[nid] = left;
+
+            u64 len = graph.node(nid).seg.size();
+            LetterLoc beg = lloc.compress(NodePos(nid, 0));
+            for (u64 i = 0; i < std::min(len, left); ++i)
+                dirty[beg + i] = true;
+            if (left > len)
+                for (const auto &fwd : graph.forward_from(nid))
+                    stack.emplace_back(fwd.node_id, left - len);
+        }
+        num_dirty = std::ranges::count(dirty, true);
+    }
+
+    void _enumerate() {
+        fresh.clear();
+        letters.resize(Kmer::K);
+        for (LetterLoc loc = 0; loc < lloc.num_locations; ++loc) {
+            if (!dirty[loc])
+                continue;
+            auto beg = fresh.size();
+            _back(loc, lloc.expand(loc), 0);
+            std::sort(fresh.begin() + beg, fresh.end());
+            fresh.erase(std::unique(fresh.begin() + beg, fresh.end()), fresh.end());
+        }
+    }
+
+    // letters[i] is the (i+1)-th letter before loc
+    void _back(LetterLoc loc, NodePos np, u32 depth) {
+        if (depth == Kmer::K) {
+            Kmer kmer = Kmer::empty();
+            for (u32 i = Kmer::K; i-- > 0; )
+                kmer.push_back(letters[i]);
+            if constexpr (TrieData::canonical)
+                if (!TrieData::Canonical::keep(kmer, loc, lloc))
+                    return;
+            fresh.emplace_back(loc, KmerCodec::to_int(kmer));
+            return;
+        }
+        if (np.pos > 0) {
+            letters[depth] = graph.node(np.node).seg[np.pos - 1];
+            _back(loc, NodePos(np.node, np.pos - 1), depth + 1);
+        } else {
+            for (const auto &bwd : graph.backward_from(np.node)) {
+                NodeLen len = bwd.seg.size();
+                letters[depth] = bwd.seg[len - 1];
+                _back(loc, NodePos(bwd.node_id, len - 1), depth + 1);
+            }
+        }
+    }
+
+    G2TMap _merge_g2t(const TrieData &td) const {
+        SortedStartsBuilder<typename G2TMap::StartsContainer> starts;
+        typename G2TMap::ElemsContainer elems;
+        compact_vector_set_bits(elems, log2_ceil(TrieData::total_kmers()) + 1);
+
+        auto it = fresh.begin();
+        for (LetterLoc loc = 0; loc < lloc.num_locations; ++loc) {
+            if (dirty[loc]) {
+                for (; it != fresh.end() && it->first == loc; ++it) {
+                    starts.push(loc);
+                    elems.push_back(it->second);
+                }
+            } else if (loc < old_end) {
+                for (auto kh : td.graph2trie.values_for(loc)) {
+                    starts.push(loc);
+                    elems.push_back(kh);
+                }
+            }
+        }
+        return G2TMap(starts.take(), std::move(elems));
+    }
+
+    T2GMap _merge_t2g(const TrieData &td) const {
+        std::vector<std::pair<KHolder, LetterLoc>> by_kmer;
+        by_kmer.reserve(fresh.size());
+        for (const auto &[loc, kh] : fresh)
+            by_kmer.emplace_back(kh, loc);
+        std::ranges::sort(by_kmer);
+
+        SortedStartsBuilder<typename T2GMap::StartsContainer> starts;
+        typename T2GMap::ElemsContainer elems;
+        compact_vector_set_bits(elems, log2_ceil(lloc.num_locations) + 1);
+
+        auto okeys = td.trie2graph.keys();
+        auto ok = okeys.begin(), oe = okeys.end();
+        auto nk = by_kmer.begin(), ne = by_kmer.end();
+        std::vector<LetterLoc> vals;
+        while (ok != oe || nk != ne) {
+            KHolder kh = ok == oe ? nk->first :
+                nk == ne ? KHolder(*ok) : std::min(KHolder(*ok), nk->first);
+
+            vals.clear();
+            if (ok != oe && KHolder(*ok) == kh) {
+                for (auto loc : td.trie2graph.values_for(kh))
+                    if (loc < old_end && !dirty[loc])
+                        vals.push_back(loc);
+                ++ok;
+            }
+            for (; nk != ne && nk->first == kh; ++nk)
+                vals.push_back(nk->second);
+            std::ranges::sort(vals);
+
+            for (auto loc : vals) {
+                starts.push(kh);
+                elems.push_back(loc);
+            }
+        }
+        return T2GMap(starts.take(), std::move(elems));
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __TRIE_DATA_UPDATER_H__ */
@@ -6,6 +6,7 @@
 #ifndef __TRIE_PRESENCE_H__
 #define __TRIE_PRESENCE_H__
 
+#include "triegraph/util/binary_io.h"
 #include "triegraph/util/logger.h"
 #include "triegraph/util/util.h"
 
@@ -80,6 +81,27 @@ struct TriePresence {
         return present[kmer.compress()];
     }
 
+    // vector<bool> has no data(), go through packed words
+    void save(BinaryWriter &w) const {
+        std::vector<u64> words(div_up(present.size(), 64));
+        for (u64 i = 0; i < present.size(); ++i)
+            if (present[i])
+                words[i / 64] |= u64(1) << (i % 64);
+        w.write_pod(u64(present.size()));
+        binary_save(w, words);
+    }
+
+    void load(BinaryReader &r) {
+        u64 size = r.read_pod<u64>();
+        std::vector<u64> words;
+        binary_load(r, words);
+        if (words.size() != div_up(size, 64))
+            throw "trie-presence-load-bad-size";
+        present.assign(size, false);
+        for (u64 i = 0; i < size; ++i)
+            present[i] = words[i / 64] >> (i % 64) & 1;
+    }
+
 };
 
 
@@ -103,7 +103,8 @@ struct TrieGraph {
             return Handle::invalid();
         }
         auto kmer = Kmer::from_sv(sv);
-        return data.trie_data().trie_contains(kmer) ? kmer : Handle::invalid();
+        return data.trie_data().trie_contains(kmer, data.letter_loc()) ?
+            kmer : Handle::invalid();
     }
 };
 
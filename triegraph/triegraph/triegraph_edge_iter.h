@@ -286,7 +286,7 @@ struct EdgeIterImplTrieToGraph final : EdgeIterImplBase<Edge_> {
     using Base = EdgeIterImplBase<Edge>;
 
     const TrieGraphData &trie_graph;
-    typename TrieData::t2g_values_view nps;
+    typename TrieData::t2g_lloc_view nps;
     union IterU {
         IterU() : stupid('x') {}
         char stupid;
@@ -295,7 +295,8 @@ struct EdgeIterImplTrieToGraph final : EdgeIterImplBase<Edge_> {
     } its;
 
     EdgeIterImplTrieToGraph(Kmer kmer, const TrieGraphData &tg)
-        : trie_graph(tg), nps(trie_graph.trie_data().t2g_values_for(kmer))
+        : trie_graph(tg),
+          nps(trie_graph.trie_data().t2g_values_for(kmer, trie_graph.letter_loc()))
     {
         after_inc();
     }
@@ -463,7 +464,7 @@ struct EditEdgeIter {
                 u32 bitset = 0;
                 for (typename Letter::Holder l = 0; l < Letter::num_options; ++l) {
                     nkmer.push_back(l);
-                    if (tgd.trie_data().t2g_contains(nkmer)) {
+                    if (tgd.trie_data().t2g_contains(nkmer, tgd.letter_loc())) {
                         bitset |= 1 << l;
                     }
                     nkmer.pop();
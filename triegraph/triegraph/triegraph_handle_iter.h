@@ -70,7 +70,7 @@ struct PrevHandleIter {
     using Self = PrevHandleIter;
     // using Kmer = Handle::Kmer;
     // using LetterLoc = TrieGraphData::LetterLocData::LetterLoc;
-    using G2TValueView = TrieGraphData::TrieData::g2t_values_view;
+    using G2TValueView = TrieGraphData::TrieData::g2t_lloc_view;
 
     union {
         PrevHandleIterBase<Handle> base;
@@ -135,7 +135,8 @@ struct PrevHandleIter {
         } else {
             // from graph to trie
             auto letter_loc = tg.letter_loc().compress(h.nodepos());
-            return make_graph_to_trie(tg.trie_data().g2t_values_for(letter_loc));
+            return make_graph_to_trie(tg.trie_data().g2t_values_for(
+                        letter_loc, tg.letter_loc()));
         }
     }
 
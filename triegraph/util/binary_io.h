@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_BINARY_IO_H__
+#define __UTIL_BINARY_IO_H__
+
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace triegraph {
+
+/**
+ * Sections (arrays written with write_section) start at multiples of this, so
+ * they can be mmap-ed straight from the file. Big enough for any common page
+ * size, not only the one of the writing machine.
+ */
+static constexpr u64 BINARY_IO_SECTION_ALIGN = u64(1) << 16;
+
+/**
+ * Thin wrappers over stdio for dumping trivially copyable data. Values are
+ * written in host byte order, so files are only meant to be read back on the
+ * same machine (i.e checkpoints, not an exchange format).
+ */
+struct BinaryWriter {
+    explicit BinaryWriter(const std::string &path)
+        : f(std::fopen(path.c_str(), "wb")) {
+        if (!f)
+            throw "binary-io-open-failed";
+    }
+    BinaryWriter(const BinaryWriter &) = delete;
+    BinaryWriter &operator= (const BinaryWriter &) = delete;
+    ~BinaryWriter() { if (f) std::fclose(f); }
+
+    void write(const void *data, u64 size) {
+        if (size && std::fwrite(data, 1, size, f) != size)
+            throw "binary-io-write-failed";
+        pos += size;
+    }
+
+    template <typename T>
+    void write_pod(const T &val) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write(&val, sizeof(T));
+    }
+
+    u64 tell() const { return pos; }
+
+    /** pad with zeros up to a multiple of to */
+    void align(u64 to) {
+        static const std::vector<char> zeros(BINARY_IO_SECTION_ALIGN);
+        while (u64 pad = std::min(div_up(pos, to) * to - pos, u64(zeros.size())))
+            write(zeros.data(), pad);
+    }
+
+    /** element count, then the elements at the next section boundary */
+    template <typename T>
+    void write_section(const T *data, u64 n) {
+        static_assert(std::is_trivially_copyable_v<T>);
+        write_pod(n);
+        align(BINARY_IO_SECTION_ALIGN);
+        write(data, n * sizeof(T));
+    }
+
+    /** flush all the way to disk, and close */
+    void close() {
+        bool ok = std::fflush(f) == 0 && ::fsync(::fileno(f)) == 0;
+        ok = std::fclose(std::exchange(f, nullptr)) == 0 && ok;
+        if (!ok)
+            throw "binary-io-write-failed";
+    }
+
+private:
+    std::FILE *f;
+    u64 pos = 0;
+};
+
+struct BinaryReader {
+    /** where write_section put its elements */
+    struct Section {
+        u64 size;
+        u64 offset;
+    };
+
+    explicit BinaryReader(const std::string &path)
+        : f(std::fopen(path.c_str(), "rb")) {
+        if (!f)
+            throw "binary-io-open-failed";
+        struct stat st;
+        if (::fstat(fd(), &st) != 0) {
+            std::fclose(f);
+            throw "binary-io-open-failed";
+        }
+        file_size = st.st_size;
+    }
+    BinaryReader(const BinaryReader &) = delete;
+    BinaryReader &operator= (const BinaryReader &) = delete;
+    ~BinaryReader() { if (f) std::fclose(f); }
+
+    void read(void *data, u64 size) {
+        if (size && std::fread(data, 1, size, f) != size)
+            throw "binary-io-read-failed";
+    }
+
+    template <typename T>
+    T read_pod() {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T val;
+        read(&val, sizeof(T));
+        return val;
+    }
+
+    u64 tell() const {
+        auto res = std::ftell(f);
+        if (res < 0)
+            throw "binary-io-read-failed";
+        return res;
+    }
+
+    void seek(u64 offset) {
+        if (std::fseek(f, offset, SEEK_SET) != 0)
+            throw "binary-io-read-failed";
+    }
+
+    /** for mmap-ing sections, the position of the stream is not used */
+    int fd() const { return ::fileno(f); }
+
+    /**
+     * Header of a section written by write_section. Skips over the elements,
+     * which are then read_at or mapped from fd() at offset. Throws if they
+     * run past the end of the file (mapping them would SIGBUS on access).
+     */
+    template <typename T>
+    Section read_section() {
+        u64 n = read_pod<u64>();
+        u64 offset = div_up(tell(), BINARY_IO_SECTION_ALIGN) * BINARY_IO_SECTION_ALIGN;
+        if (offset > file_size || n > (file_size - offset) / sizeof(T))
+            throw "binary-io-truncated";
+        seek(offset + n * sizeof(T));
+        return { n, offset };
+    }
+
+    /** read size bytes at offset, keeping the stream position */
+    void read_at(void *data, u64 size, u64 offset) {
+        u64 cur = tell();
+        seek(offset);
+        read(data, size);
+        seek(cur);
+    }
+
+private:
+    std::FILE *f;
+    u64 file_size;
+};
+
+/**
+ * Save / load a value: containers with save(BinaryWriter &) /
+ * load(BinaryReader &) members, std::vector as a section (loaded in a single
+ * read), anything else trivially copyable as is.
+ */
+template <typename T>
+void binary_save(BinaryWriter &w, const T &val) {
+    if constexpr (requires { val.save(w); })
+        val.save(w);
+    else
+        w.write_pod(val);
+}
+
+template <typename T, typename A>
+void binary_save(BinaryWriter &w, const std::vector<T, A> &v) {
+    w.write_section(v.data(), v.size());
+}
+
+template <typename T>
+void binary_load(BinaryReader &r, T &val) {
+    if constexpr (requires { val.load(r); })
+        val.load(r);
+    else
+        val = r.read_pod<T>();
+}
+
+template <typename T, typename A>
+void binary_load(BinaryReader &r, std::vector<T, A> &v) {
+    auto sec = r.read_section<T>();
+    v.resize(sec.size);
+    r.read_at(v.data(), sec.size * sizeof(T), sec.offset);
+}
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_BINARY_IO_H__ */
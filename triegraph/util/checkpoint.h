@@ -0,0 +1,125 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_CHECKPOINT_H__
+#define __UTIL_CHECKPOINT_H__
+
+#include "triegraph/util/binary_io.h"
+#include "triegraph/util/logger.h"
+#include "triegraph/util/util.h"
+
+#include <filesystem>
+#include <string>
+#include <system_error>
+#include <utility>
+
+namespace triegraph {
+
+/**
+ * Directory holding the outputs of completed build stages, so a restarted
+ * build can skip them.
+ *
+ * Every stage file starts with a header containing a fingerprint of the
+ * inputs (graph, kmer settings, algorithm ...). Files with a different
+ * fingerprint are ignored, so a stale directory never leaks into a new build.
+ * Stages are written to a temp file and renamed into place, so a build killed
+ * mid-write leaves no half-written stage behind.
+ *
+ * With an empty dir checkpointing is disabled: nothing is saved, and nothing
+ * is loaded.
+ */
+struct Checkpoint {
+    static constexpr u64 MAGIC = 0x313074706b636774ull; // "tgckpt01"
+
+    struct Settings {
+        std::string dir = "";
+
+        static Settings from_config(const auto &cfg) {
+            return {
+                .dir = cfg.template get_or<std::string>("checkpoint-dir", ""),
+            };
+        }
+    };
+
+    Checkpoint(Settings s, u64 fingerprint)
+        : settings(std::move(s)), fingerprint(fingerprint) {
+        if (enabled())
+            std::filesystem::create_directories(settings.dir);
+    }
+
+    bool enabled() const { return !settings.dir.empty(); }
+
+    std::string path(const std::string &stage) const {
+        return std::filesystem::path(settings.dir) / (stage + ".ckpt");
+    }
+
+    bool has(const std::string &stage) const {
+        if (!enabled() || !std::filesystem::exists(path(stage)))
+            return false;
+        BinaryReader r(path(stage));
+        return _read_header(r);
+    }
+
+    /** write(BinaryWriter &) dumps the stage */
+    void save(const std::string &stage, auto &&write) const {
+        if (!enabled())
+            return;
+        auto scope = Logger::get().begin_scoped("checkpoint save " + stage);
+        auto tmp = path(stage) + ".tmp";
+        {
+            BinaryWriter w(tmp);
+            w.write_pod(MAGIC);
+            w.write_pod(fingerprint);
+            write(w);
+            w.close();
+        }
+        std::filesystem::rename(tmp, path(stage));
+    }
+
+    /**
+     * read(BinaryReader &) restores the stage. Returns false (without calling
+     * read) if the stage is missing or from a different build.
+     */
+    bool load(const std::string &stage, auto &&read) const {
+        if (!enabled() || !std::filesystem::exists(path(stage)))
+            return false;
+        BinaryReader r(path(stage));
+        if (!_read_header(r))
+            return false;
+        auto scope = Logger::get().begin_scoped("checkpoint load " + stage);
+        read(r);
+        return true;
+    }
+
+    void remove(const std::string &stage) const {
+        if (!enabled())
+            return;
+        std::error_code ec;
+        std::filesystem::remove(path(stage), ec);
+    }
+
+    const Settings &get_settings() const { return settings; }
+
+private:
+    Settings settings;
+    u64 fingerprint;
+
+    bool _read_header(BinaryReader &r) const {
+        try {
+            return r.read_pod<u64>() == MAGIC && r.read_pod<u64>() == fingerprint;
+        } catch (const char *) {
+            return false;
+        }
+    }
+};
+
+/** boost::hash_combine */
+inline u64 hash_combine(u64 seed, u64 val) {
+    return seed ^ (val + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2));
+}
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_CHECKPOINT_H__ */
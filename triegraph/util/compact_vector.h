@@ -6,8 +6,12 @@
 #ifndef __COMPACT_VECTOR_H__
 #define __COMPACT_VECTOR_H__
 
+#include "triegraph/util/binary_io.h"
+#include "triegraph/util/radix_sort.h"
 #include "triegraph/util/util.h"
 
+#include <algorithm>
+#include <bit>
 #include <cassert>
 #include <cstdlib> /* div */
 #include <type_traits>
@@ -15,9 +19,14 @@
 
 namespace triegraph {
 
-template <typename T>
+/**
+ * Vector of bits-wide unsigned values, packed in consecutive words of
+ * Storage (a std::vector<T> or a VmVector<T>).
+ */
+template <typename T, typename Storage = std::vector<T>>
 struct CompactVector {
     static_assert(std::is_unsigned_v<T>);
+    static_assert(std::is_same_v<typename Storage::value_type, T>);
     static constexpr u32 max_bits = sizeof(T) * BITS_PER_BYTE;
     static constexpr T lsh(T base, u32 shift) { return shift < max_bits ? (base << shift) : 0; }
     static constexpr T rsh(T base, u32 shift) { return shift < max_bits ? (base >> shift) : 0; }
@@ -25,8 +34,8 @@ struct CompactVector {
 
     template <bool cnst>
     using data_iterator = std::conditional_t<cnst,
-          typename std::vector<T>::const_iterator,
-          typename std::vector<T>::iterator>;
+          typename Storage::const_iterator,
+          typename Storage::iterator>;
     using Self = CompactVector;
     using value_type = T;
 
@@ -49,6 +58,30 @@ struct CompactVector {
     Self &set_bits(u32 bits) & { set_bits_(bits); return *this; }
     Self &&set_bits(u32 bits) && { set_bits_(bits); return std::move(*this); }
 
+    /**
+     * Repack the elements to nbits (if more than bits), in place. Elements
+     * are moved from the last one down, element i's new slot starts at or
+     * after its old one, so it only overwrites elements already moved.
+     */
+    void widen(u32 nbits) {
+        assert(nbits <= max_bits);
+        if (nbits <= bits)
+            return;
+        if (sz > 0)
+            data.resize(div((sz - 1) * nbits, u64(max_bits)).quot + 2, T(0));
+        T nmask = mask_(nbits);
+        for (u64 i = sz; i-- > 0; ) {
+            T val = Ref<false>(data.begin(), div(i * bits, u64(max_bits)), mask);
+            Ref<false>(data.begin(), div(i * nbits, u64(max_bits)), nmask) = val;
+        }
+        mask = nmask;
+        bits = nbits;
+    }
+
+    /** widen on push_back of values that don't fit, instead of masking */
+    Self &set_auto_widen(bool on) & { auto_widen = on; return *this; }
+    Self &&set_auto_widen(bool on) && { auto_widen = on; return std::move(*this); }
+
     void reserve(u64 size) {
         auto dr = div((size - 1) * bits, u64(max_bits));
         u64 ncap = dr.quot + 2;
@@ -69,7 +102,10 @@ struct CompactVector {
 
     void resize(u64 size) {
         if (size > sz) {
-            throw "compact-vector-resize-up-not-implemented";
+            // new elements are 0, clear what is left past the end
+            auto dr = div(sz * bits, u64(max_bits));
+            data[dr.quot] &= mask_(dr.rem);
+            std::fill(data.begin() + dr.quot + 1, data.end(), T(0));
         }
         if (size == 0) {
             data.resize(1);
@@ -81,6 +117,8 @@ struct CompactVector {
     }
 
     void push_back(const T &val) {
+        if (auto_widen && (val & ~mask)) [[unlikely]]
+            widen(std::bit_width(val));
         auto dr = div(sz * bits, u64(max_bits));
         if (dr.quot + 1 >= data.size())
             data.push_back(0);
@@ -97,6 +135,94 @@ struct CompactVector {
         return push_back(T(std::forward<Args>(args)...));
     }
 
+    /** decode [beg, end) into out, walking the words once (no Ref) */
+    void unpack(u64 beg, u64 end, T *out) const {
+        if (beg >= end)
+            return;
+        auto dr = div(beg * bits, u64(max_bits));
+        auto it = data.begin() + dr.quot;
+        u32 rem = dr.rem;
+        for (u64 i = beg; i < end; ++i) {
+            *out++ = (*it >> rem | lsh(*(it+1), max_bits - rem)) & mask;
+            rem += bits;
+            if (rem >= max_bits) {
+                ++ it;
+                rem -= max_bits;
+            }
+        }
+    }
+
+    std::vector<T> unpack() const {
+        std::vector<T> res(sz);
+        unpack(0, sz, res.data());
+        return res;
+    }
+
+    /** replace the contents with vals[0, n), writing whole words */
+    void pack(const T *vals, u64 n) {
+        data.clear();
+        data.reserve(n == 0 ? 1 : (n - 1) * bits / max_bits + 2);
+        T word = 0;
+        u32 rem = 0;
+        for (u64 i = 0; i < n; ++i) {
+            T val = vals[i] & mask;
+            word |= val << rem;
+            rem += bits;
+            if (rem >= max_bits) {
+                data.push_back(word);
+                rem -= max_bits;
+                word = rsh(val, bits - rem);
+            }
+        }
+        data.push_back(word);
+        data.resize(n == 0 ? 1 : (n - 1) * bits / max_bits + 2, 0);
+        sz = n;
+    }
+
+    void pack(const std::vector<T> &vals) { pack(vals.data(), vals.size()); }
+
+    /** overwrite [beg, beg + n) with vals[0, n), writing whole words */
+    void pack_at(u64 beg, const T *vals, u64 n) {
+        if (n == 0)
+            return;
+        auto dr = div(beg * bits, u64(max_bits));
+        auto it = data.begin() + dr.quot;
+        u32 rem = dr.rem;
+        T word = *it & mask_(rem); // what is before beg
+        for (u64 i = 0; i < n; ++i) {
+            T val = vals[i] & mask;
+            word |= val << rem;
+            rem += bits;
+            if (rem >= max_bits) {
+                *it++ = word;
+                rem -= max_bits;
+                word = rsh(val, bits - rem);
+            }
+        }
+        if (rem > 0) // keep what is after beg + n
+            *it = word | (*it & ~mask_(rem));
+    }
+
+    /** the packed words are saved as is, and loaded at once (or mapped) */
+    void save(BinaryWriter &w) const {
+        w.write_pod(bits);
+        w.write_pod(sz);
+        binary_save(w, data);
+    }
+
+    void load(BinaryReader &r) {
+        u32 nbits = r.read_pod<u32>();
+        u64 nsz = r.read_pod<u64>();
+        if (nbits == 0 || nbits > max_bits)
+            throw "compact-vector-load-bad-bits";
+        binary_load(r, data);
+        if (data.size() < (nsz == 0 ? 1 : (nsz - 1) * nbits / max_bits + 2))
+            throw "compact-vector-load-bad-size";
+        mask = mask_(nbits);
+        bits = nbits;
+        sz = nsz;
+    }
+
     template <bool cnst>
     struct Ref {
         data_iterator<cnst> it;
@@ -128,8 +254,12 @@ struct CompactVector {
 
             *it &= ~(mask << rem);
             *it |= (val & mask) << rem;
-            *(it+1) &= ~rsh(mask, max_bits - rem);
-            *(it+1) |= rsh(val & mask, max_bits - rem);
+            // only touch the next word if the value spills into it, so
+            // threads writing to disjoint word ranges don't race
+            if (T spill = rsh(mask, max_bits - rem)) {
+                *(it+1) &= ~spill;
+                *(it+1) |= rsh(val & mask, max_bits - rem);
+            }
 
             // std::cerr
             //     << " it   " << std::hex << *it << std::dec
@@ -254,25 +384,61 @@ struct CompactVector {
     const_iterator end() const { return begin() + size(); }
 
 
-    std::vector<T> data;
+    Storage data;
     T mask;
     u32 bits;
     u64 sz;
+    bool auto_widen = false;
 };
 
-template <typename T>
-void compact_vector_set_bits(CompactVector<T> &cv, u32 bits) { cv.set_bits(bits); }
-template <typename T>
-void compact_vector_set_bits(std::vector<T> &v, u32 bits) {
-    if (bits > sizeof(T) * BITS_PER_BYTE)
+// the plain overloads are for any vector-like container (std::vector,
+// VmVector)
+template <typename T, typename S>
+void compact_vector_set_bits(CompactVector<T, S> &cv, u32 bits) { cv.set_bits(bits); }
+template <typename V>
+void compact_vector_set_bits(V &v, u32 bits) {
+    if (bits > sizeof(typename V::value_type) * BITS_PER_BYTE)
         throw "not-enough-bits-vector";
 }
 
+template <typename T, typename S>
+u32 compact_vector_get_bits(const CompactVector<T, S> &cv) { return cv.bits; }
+
+template <typename T, typename S>
+void compact_vector_widen(CompactVector<T, S> &cv, u32 bits) { cv.widen(bits); }
+template <typename V>
+void compact_vector_widen(V &v, u32 bits) {
+    if (bits > sizeof(typename V::value_type) * BITS_PER_BYTE)
+        throw "not-enough-bits-vector";
+}
+
+template <typename T, typename S>
+void compact_vector_set_auto_widen(CompactVector<T, S> &cv, bool on) {
+    cv.set_auto_widen(on);
+}
+template <typename V>
+void compact_vector_set_auto_widen(V &, bool) {}
+
+/**
+ * Sort through a full width copy: unpack, radix sort, repack word by word.
+ * Much faster than std::sort over Ref proxies, for a temporary n * sizeof(T).
+ */
+template <typename T, typename S>
+void compact_vector_sort(CompactVector<T, S> &cv) {
+    auto vals = cv.unpack();
+    radix_sort(vals, [](T v) { return v; }, cv.bits);
+    cv.pack(vals);
+}
+template <typename V>
+void compact_vector_sort(V &v) { std::ranges::sort(v); }
+
 template <typename T>
-u32 compact_vector_get_bits(const CompactVector<T> &cv) { return cv.bits; }
-template <typename T>
-u32 compact_vector_get_bits(const std::vector<T> &v) {
-    return sizeof(T) * BITS_PER_BYTE;
+inline constexpr bool is_compact_vector_v = false;
+template <typename T, typename S>
+inline constexpr bool is_compact_vector_v<CompactVector<T, S>> = true;
+template <typename V>
+u32 compact_vector_get_bits(const V &v) {
+    return sizeof(typename V::value_type) * BITS_PER_BYTE;
 }
 
 } /* namespace triegraph */
@@ -0,0 +1,266 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_CONCURRENT_PAIRS_SINK_H__
+#define __UTIL_CONCURRENT_PAIRS_SINK_H__
+
+#include "triegraph/util/compact_vector.h"
+#include "triegraph/util/util.h"
+#include "triegraph/util/vector_pairs.h"
+#include "triegraph/util/vm_vector.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+namespace impl {
+
+// column with the same layout, over VmVector words
+template <typename V>
+struct vm_column { using type = VmVector<typename V::value_type>; };
+template <typename T, typename S>
+struct vm_column<CompactVector<T, S>> { using type = CompactVector<T, VmVector<T>>; };
+
+} /* namespace impl */
+
+/**
+ * Pairs sink for VectorPairsDual, that any number of threads can
+ * emplace_back into at once.
+ *
+ * Both columns live in VmVectors (directly or as CompactVector words), so
+ * they never move while growing. Each thread claims a chunk of CHUNK
+ * consecutive indices (under a lock) and fills it without locking. CHUNK is a
+ * multiple of the word size, so chunks of CompactVector columns don't share
+ * words.
+ *
+ * take() moves pairs from the end into the unfilled tails of the chunks
+ * (at most a chunk per thread) and hands the columns over to VectorPairs.
+ * Columns of VmVector storage are moved, others (std::vector) are copied
+ * once, doubling the peak -- Manager only uses the sink for VmVector pairs.
+ *
+ * Values must fit the CompactVector widths set up front (there is no
+ * concurrent widening).
+ */
+template <typename VectorPairs_>
+struct ConcurrentPairsSink {
+    using VectorPairs = VectorPairs_;
+    using T1 = VectorPairs::T1;
+    using T2 = VectorPairs::T2;
+    using V1 = VectorPairs::Column1;
+    using V2 = VectorPairs::Column2;
+    using C1 = impl::vm_column<V1>::type;
+    using C2 = impl::vm_column<V2>::type;
+    using value_type = VectorPairs::value_type;
+    using Self = ConcurrentPairsSink;
+
+    static_assert(VectorPairs::impl == VectorPairsImpl::DUAL);
+
+    static constexpr bool concurrent = true;
+    static constexpr u64 CHUNK = u64(1) << 16;
+
+    /** proto gives the column widths and VectorPairs settings */
+    ConcurrentPairsSink(VectorPairs &&proto = {})
+        : proto(std::move(proto)),
+          id(++next_id)
+    {
+        _reset(compact_vector_get_bits(this->proto.get_v1()),
+                compact_vector_get_bits(this->proto.get_v2()));
+    }
+
+    ConcurrentPairsSink(const Self &) = delete;
+    ConcurrentPairsSink(Self &&) = delete;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = delete;
+
+    /** pairs emplaced so far (excluding ones in flight) */
+    size_t size() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        u64 unused = 0;
+        for (const auto &c : chunks)
+            unused += c->end - c->pos;
+        return next - unused;
+    }
+    void reserve(size_t) {}
+    void set_order(VectorPairsOrder o) { order = o; }
+
+    template <typename Tx1, typename Tx2>
+    void emplace_back(Tx1 &&a, Tx2 &&b) {
+        Chunk &c = _chunk();
+        if (c.pos == c.end)
+            _refill(c);
+        _put(c.pos++, T1(std::forward<Tx1>(a)), T2(std::forward<Tx2>(b)));
+    }
+    void push_back(const auto &p) { emplace_back(p.first, p.second); }
+
+    /** call once, after all threads are done emplacing */
+    VectorPairs take() {
+        u64 n = _stitch();
+        col1.resize(n);
+        col2.resize(n);
+        // forget the threads' cached chunks
+        id = ++next_id;
+        chunks.clear();
+        next = 0;
+
+        auto bits1 = compact_vector_get_bits(col1);
+        auto bits2 = compact_vector_get_bits(col2);
+        VectorPairs res = std::move(proto);
+        _hand_over(col1, res.get_v1());
+        _hand_over(col2, res.get_v2());
+        res.set_order(order);
+        _reset(bits1, bits2);
+        return res;
+    }
+
+private:
+    struct Chunk {
+        std::thread::id tid;
+        u64 pos = 0;
+        u64 end = 0;
+    };
+    struct Cache {
+        u64 sink_id = 0;
+        Chunk *chunk = nullptr;
+    };
+    static inline std::atomic<u64> next_id = 0;
+
+    VectorPairs proto;
+    u64 id;
+    C1 col1;
+    C2 col2;
+    VectorPairsOrder order = VectorPairsOrder::NONE;
+    mutable std::mutex mtx;
+    std::vector<std::unique_ptr<Chunk>> chunks;
+    u64 next = 0;
+
+    void _reset(u32 bits1, u32 bits2) {
+        col1 = C1 {};
+        col2 = C2 {};
+        compact_vector_set_bits(col1, bits1);
+        compact_vector_set_bits(col2, bits2);
+        // reserve the address ranges now, they must not move later
+        col1.reserve(1);
+        col2.reserve(1);
+    }
+
+    // the calling thread's chunk, remembered per thread
+    Chunk &_chunk() {
+        thread_local Cache cache;
+        if (cache.sink_id == id)
+            return *cache.chunk;
+        auto tid = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = std::ranges::find_if(chunks,
+                [tid](const auto &c) { return c->tid == tid; });
+        if (it == chunks.end()) {
+            chunks.push_back(std::make_unique<Chunk>(tid));
+            it = chunks.end() - 1;
+        }
+        cache = { id, it->get() };
+        return **it;
+    }
+
+    void _refill(Chunk &c) {
+        std::lock_guard<std::mutex> lk(mtx);
+        u64 end = next + CHUNK;
+        if (!_fits(col1, end) || !_fits(col2, end))
+            throw "concurrent-pairs-sink-reservation-exceeded";
+        // only the indices past all chunks are touched
+        col1.resize(end);
+        col2.resize(end);
+        c.pos = next;
+        c.end = next = end;
+    }
+
+    template <typename T>
+    static bool _fits(const VmVector<T> &v, u64 size) {
+        return size * sizeof(T) <= v.reserved_bytes();
+    }
+    template <typename T>
+    static bool _fits(const CompactVector<T, VmVector<T>> &cv, u64 size) {
+        return (div_up(size * cv.bits, cv.max_bits) + 1) * sizeof(T) <=
+            cv.data.reserved_bytes();
+    }
+
+    void _put(u64 idx, T1 a, T2 b) {
+        _check(col1, a);
+        _check(col2, b);
+        col1[idx] = a;
+        col2[idx] = b;
+    }
+
+    template <typename T>
+    static void _check(const VmVector<T> &, const T &) {}
+    template <typename T>
+    static void _check(const CompactVector<T, VmVector<T>> &cv, T val) {
+        if (val & ~cv.mask)
+            throw "concurrent-pairs-sink-value-too-wide";
+    }
+
+    // move used indices from the end into the unfilled chunk tails, returns
+    // the number of pairs
+    u64 _stitch() {
+        std::vector<std::pair<u64, u64>> holes;
+        u64 unused = 0;
+        for (const auto &c : chunks) {
+            if (c->pos < c->end) {
+                holes.emplace_back(c->pos, c->end);
+                unused += c->end - c->pos;
+            }
+        }
+        std::ranges::sort(holes);
+        u64 n = next - unused;
+
+        std::vector<u64> dst;
+        for (const auto &[beg, end] : holes)
+            for (u64 i = beg; i < std::min(end, n); ++i)
+                dst.push_back(i);
+        auto hole = holes.begin();
+        u64 moved = 0;
+        for (u64 src = n; src < next; ++src) {
+            while (hole != holes.end() && hole->second <= src)
+                ++hole;
+            if (hole != holes.end() && hole->first <= src)
+                continue;
+            col1[dst[moved]] = T1(col1[src]);
+            col2[dst[moved]] = T2(col2[src]);
+            ++moved;
+        }
+        return n;
+    }
+
+    template <typename C, typename V>
+    static void _hand_over(C &col, V &out) {
+        if constexpr (std::is_same_v<C, V> && is_compact_vector_v<V>) {
+            bool auto_widen = out.auto_widen;
+            out = std::move(col);
+            out.auto_widen = auto_widen;
+        } else if constexpr (std::is_same_v<C, V>) {
+            out = std::move(col);
+        } else if constexpr (is_compact_vector_v<V>) {
+            out.data.clear();
+            out.data.reserve(col.data.size());
+            for (auto word : col.data)
+                out.data.push_back(word);
+            out.sz = col.sz;
+        } else {
+            out.clear();
+            out.reserve(col.size());
+            for (const auto &val : col)
+                out.push_back(val);
+        }
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_CONCURRENT_PAIRS_SINK_H__ */
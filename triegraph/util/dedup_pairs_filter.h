@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_DEDUP_PAIRS_FILTER_H__
+#define __UTIL_DEDUP_PAIRS_FILTER_H__
+
+#include "triegraph/util/util.h"
+#include "triegraph/util/vector_pairs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+struct DedupPairsSettings {
+    /** log2 of the slots in each per thread cache, 0 -- disabled */
+    u32 bits = 0;
+
+    static DedupPairsSettings from_config(const auto &cfg) {
+        return {
+            .bits = cfg.template get_or<u32>("trie-pairs-dedup-bits", 0u),
+        };
+    }
+
+    /** used by filters constructed without settings */
+    static DedupPairsSettings &default_settings() {
+        static DedupPairsSettings settings;
+        return settings;
+    }
+};
+
+/**
+ * Pairs sink, that drops pairs it has recently seen, before they reach the
+ * pair buffer (and the sort).
+ *
+ * Each thread has a direct mapped cache of 2^bits pairs, indexed by a hash
+ * of the pair. A pair equal to the one in its slot is dropped, otherwise it
+ * replaces it and is passed on. So only true duplicates are dropped, but
+ * not all of them (unique() is still needed) -- the ones emitted close
+ * together, as by NBFS when walks through bubbles meet.
+ *
+ * With bits = 0 pairs are passed on unchanged.
+ */
+template <typename Sink, typename T1, typename T2>
+struct DedupPairsFilter {
+    using Self = DedupPairsFilter;
+    using Settings = DedupPairsSettings;
+    using value_type = std::pair<T1, T2>;
+    static constexpr bool concurrent = concurrent_pairs_sink_v<Sink>;
+
+    struct Stats {
+        u64 seen = 0;
+        u64 dropped = 0;
+
+        double ratio() const { return seen ? double(dropped) / seen : 0.0; }
+    };
+
+    DedupPairsFilter(Sink &sink, Settings settings = Settings::default_settings())
+        : sink(sink),
+          settings(settings),
+          id(++next_id)
+    {
+        if (settings.bits >= 32)
+            throw "dedup-pairs-filter-too-many-bits";
+    }
+
+    DedupPairsFilter(const Self &) = delete;
+    DedupPairsFilter(Self &&) = delete;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = delete;
+
+    bool enabled() const { return settings.bits > 0; }
+
+    size_t size() const { return sink.size(); }
+    void reserve(size_t capacity) { sink.reserve(capacity); }
+    void set_order(auto o) { sink.set_order(o); }
+
+    void emplace_back(const T1 &a, const T2 &b) {
+        if (enabled()) {
+            Cache &c = _cache();
+            ++c.seen;
+            Slot &slot = c.slots[_hash(a, b) & c.mask];
+            if (slot.used && slot.a == a && slot.b == b) {
+                ++c.dropped;
+                return;
+            }
+            slot = { a, b, true };
+        }
+        sink.emplace_back(a, b);
+    }
+    void push_back(const auto &p) { emplace_back(p.first, p.second); }
+
+    /** pairs seen and dropped, call after all threads are done */
+    Stats stats() const {
+        std::lock_guard<std::mutex> lk(mtx);
+        Stats res;
+        for (const auto &c : caches) {
+            res.seen += c->seen;
+            res.dropped += c->dropped;
+        }
+        return res;
+    }
+
+private:
+    struct Slot {
+        T1 a {};
+        T2 b {};
+        bool used = false;
+    };
+    struct Cache {
+        std::thread::id tid;
+        std::vector<Slot> slots;
+        u64 mask;
+        u64 seen = 0;
+        u64 dropped = 0;
+
+        Cache(std::thread::id tid, u32 bits)
+            : tid(tid), slots(u64(1) << bits), mask((u64(1) << bits) - 1) {}
+    };
+    struct CacheRef {
+        u64 filter_id = 0;
+        Cache *cache = nullptr;
+    };
+    static inline std::atomic<u64> next_id = 0;
+
+    Sink &sink;
+    Settings settings;
+    u64 id;
+    mutable std::mutex mtx;
+    std::vector<std::unique_ptr<Cache>> caches;
+
+    // the calling thread's cache, remembered per thread (for the last
+    // filter used), looked up by thread id otherwise
+    Cache &_cache() {
+        thread_local CacheRef ref;
+        if (ref.filter_id == id)
+            return *ref.cache;
+        auto tid = std::this_thread::get_id();
+        std::lock_guard<std::mutex> lk(mtx);
+        auto it = std::ranges::find_if(caches,
+                [tid](const auto &c) { return c->tid == tid; });
+        if (it == caches.end()) {
+            caches.push_back(std::make_unique<Cache>(tid, settings.bits));
+            it = caches.end() - 1;
+        }
+        ref = { id, it->get() };
+        return *ref.cache;
+    }
+
+    static u64 _hash(const T1 &a, const T2 &b) {
+        return mix64(std::hash<T1>{}(a) * 0x9e3779b97f4a7c15ull ^ std::hash<T2>{}(b));
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_DEDUP_PAIRS_FILTER_H__ */
@@ -6,6 +6,7 @@
 #ifndef __DENSE_MULTIMAP_H__
 #define __DENSE_MULTIMAP_H__
 
+#include "triegraph/util/binary_io.h"
 #include "triegraph/util/multimaps.h"
 #include "triegraph/util/sorted_vector.h"
 
@@ -72,6 +73,16 @@ struct DenseMultimap {
     DenseMultimap &operator= (DenseMultimap &&) = default;
 
     size_t size() const { return elems.size(); }
+
+    void save(BinaryWriter &w) const {
+        binary_save(w, starts);
+        binary_save(w, elems);
+    }
+
+    void load(BinaryReader &r) {
+        binary_load(r, starts);
+        binary_load(r, elems);
+    }
     // size_t key_size() const { return elems.size(); }
 
     struct PairIter {
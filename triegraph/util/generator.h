@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_GENERATOR_H__
+#define __UTIL_GENERATOR_H__
+
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <utility>
+
+namespace triegraph {
+
+/**
+ * Lazy input range of the values co_yield-ed by a coroutine (a small
+ * std::generator, until C++23).
+ *
+ * The coroutine runs until the next co_yield on each increment, and the
+ * yielded value is referenced (not copied) until then. Exceptions thrown in
+ * the coroutine propagate out of begin() / operator++.
+ */
+template <typename T>
+struct Generator {
+    struct promise_type;
+    using Handle = std::coroutine_handle<promise_type>;
+    using Self = Generator;
+
+    struct promise_type {
+        const T *cur = nullptr;
+        std::exception_ptr exc;
+
+        Generator get_return_object() {
+            return Generator(Handle::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always final_suspend() noexcept { return {}; }
+        std::suspend_always yield_value(const T &val) noexcept {
+            cur = std::addressof(val);
+            return {};
+        }
+        void return_void() noexcept {}
+        void unhandled_exception() { exc = std::current_exception(); }
+        // no co_await in generators
+        template <typename U>
+        std::suspend_never await_transform(U &&) = delete;
+    };
+
+    struct iterator {
+        using value_type = T;
+        using difference_type = std::ptrdiff_t;
+
+        Handle h;
+
+        const T &operator* () const { return *h.promise().cur; }
+        const T *operator-> () const { return h.promise().cur; }
+        iterator &operator++ () { _resume(h); return *this; }
+        void operator++ (int) { ++*this; }
+        bool operator== (std::default_sentinel_t) const { return h.done(); }
+    };
+
+    Generator() {}
+    Generator(const Self &) = delete;
+    Generator(Self &&other) : h(std::exchange(other.h, {})) {}
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&other) {
+        Generator(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~Generator() {
+        if (h)
+            h.destroy();
+    }
+    void swap(Self &other) { std::swap(h, other.h); }
+
+    /** starts the coroutine, call once */
+    iterator begin() {
+        _resume(h);
+        return { h };
+    }
+    std::default_sentinel_t end() const { return {}; }
+
+private:
+    explicit Generator(Handle h) : h(h) {}
+
+    static void _resume(Handle h) {
+        h.resume();
+        if (h.promise().exc)
+            std::rethrow_exception(std::exchange(h.promise().exc, {}));
+    }
+
+    Handle h;
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_GENERATOR_H__ */
@@ -44,9 +44,12 @@ struct Logger {
 
     enum separator { NONE, SPACE, NEWLINE };
     static inline Logger *instance = nullptr;
+    static inline thread_local Logger *thread_instance = nullptr;
     static inline bool enabled = true;
 
     static Logger& get() {
+        if (thread_instance != nullptr)
+            return *thread_instance;
         if (instance == nullptr) {
             instance = new Logger();
             atexit(&Logger::free);
@@ -69,9 +72,17 @@ struct Logger {
         Memory mem;
     };
 
-    Logger() : os(std::cerr) {
+    explicit Logger(bool muted = false) : os(std::cerr), muted(muted) {
         begin("main");
     }
+
+    /**
+     * While in scope, get() on the calling thread returns a muted Logger of
+     * its own. The shared Logger is not thread safe, so code that logs and
+     * runs on a helper thread (i.e a pairs_generator producer) must not
+     * touch it.
+     */
+    struct ThreadMute;
     ~Logger() { while (!timers.empty()) end(); }
 
     // template <typename... Args>
@@ -161,7 +172,7 @@ private:
 
     template <int sep=SPACE, typename... Args>
     void print(std::ostream &os, Args&&... args) {
-        if (enabled) {
+        if (enabled && !muted) {
             auto x = {0, ((void) (os
                         << (sep == NONE ? "" : sep == SPACE ? " " : "\n")
                         << std::forward<Args>(args)), 0)... };
@@ -174,7 +185,7 @@ private:
         // auto x = {0, ((void) (os << sep << std::forward<Args>(args)), 0)... };
         // (void) x;
         print<sep>(os, std::forward<Args>(args)...);
-        if (enabled) os << std::endl;
+        if (enabled && !muted) os << std::endl;
     }
 
     // typename Timer::duration_rep _time_diff(Timer a) {
@@ -225,9 +236,20 @@ private:
     }
 
     std::ostream &os;
+    bool muted;
     std::vector<Snapshot> timers;
 };
 
+struct Logger::ThreadMute {
+    Logger log { true };
+    Logger *prev;
+
+    ThreadMute() : prev(std::exchange(thread_instance, &log)) {}
+    ThreadMute(const ThreadMute &) = delete;
+    ThreadMute &operator= (const ThreadMute &) = delete;
+    ~ThreadMute() { thread_instance = prev; }
+};
+
 } /* namespace triegraph */
 
 #endif /* __LOGGER_H__ */
@@ -76,6 +76,12 @@ struct Memory {
         return res;
     }
 
+    // drop VmHWM down to the current VmRSS (linux >= 4.0)
+    static void reset_peak() {
+        std::ostringstream fn;
+        fn << "/proc/" << getpid() << "/clear_refs";
+        std::ofstream { fn.str() } << "5";
+    }
 
     friend std::ostream &operator<< (std::ostream &os, const Memory &res) {
         return os
@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_PAIRS_GENERATOR_H__
+#define __UTIL_PAIRS_GENERATOR_H__
+
+#include "triegraph/util/generator.h"
+#include "triegraph/util/logger.h"
+#include "triegraph/util/util.h"
+#include "triegraph/util/vector_pairs.h"
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+namespace impl {
+
+// bounded queue of pair blocks, from one producer to one consumer
+template <typename T>
+struct PairsChannel {
+    explicit PairsChannel(u32 max_blocks) : max_blocks(max_blocks) {}
+
+    void push(std::vector<T> &&block) {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this] { return cancelled || blocks.size() < max_blocks; });
+        if (cancelled)
+            throw "pairs-generator-cancelled";
+        blocks.push_back(std::move(block));
+        cv.notify_all();
+    }
+
+    // false when the producer is done (rethrows its exception)
+    bool pop(std::vector<T> &block) {
+        std::unique_lock<std::mutex> lk(mtx);
+        cv.wait(lk, [this] { return done || !blocks.empty(); });
+        if (blocks.empty()) {
+            if (exc)
+                std::rethrow_exception(std::exchange(exc, {}));
+            return false;
+        }
+        block = std::move(blocks.front());
+        blocks.pop_front();
+        cv.notify_all();
+        return true;
+    }
+
+    void finish(std::exception_ptr e) {
+        std::lock_guard<std::mutex> lk(mtx);
+        done = true;
+        exc = cancelled ? nullptr : e;
+        cv.notify_all();
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> lk(mtx);
+        cancelled = true;
+        cv.notify_all();
+    }
+
+private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<std::vector<T>> blocks;
+    u32 max_blocks;
+    bool done = false;
+    bool cancelled = false;
+    std::exception_ptr exc;
+};
+
+} /* namespace impl */
+
+/**
+ * Pairs sink handing blocks of pairs to a pairs_generator consumer. Has the
+ * interface builders expect from VectorPairs (order is not kept).
+ */
+template <typename T1_, typename T2_>
+struct PairsChannelSink {
+    using T1 = T1_;
+    using T2 = T2_;
+    using value_type = std::pair<T1, T2>;
+    using Channel = impl::PairsChannel<value_type>;
+
+    PairsChannelSink(Channel &channel, u64 block_size)
+        : channel(channel), block_size(block_size) {
+        block.reserve(block_size);
+    }
+
+    /** pairs emplaced so far */
+    size_t size() const { return total; }
+    void reserve(size_t) {}
+    void set_order(VectorPairsOrder) {}
+
+    template <typename Tx1, typename Tx2>
+    void emplace_back(Tx1 &&a, Tx2 &&b) {
+        block.emplace_back(T1(std::forward<Tx1>(a)), T2(std::forward<Tx2>(b)));
+        ++total;
+        if (block.size() == block_size)
+            flush();
+    }
+    void push_back(const auto &p) { emplace_back(p.first, p.second); }
+
+    void flush() {
+        if (block.empty())
+            return;
+        channel.push(std::move(block));
+        block = {};
+        block.reserve(block_size);
+    }
+
+private:
+    Channel &channel;
+    u64 block_size;
+    std::vector<value_type> block;
+    u64 total = 0;
+};
+
+/**
+ * Pull-based range over the pairs a push-based producer (like a trie
+ * builder) emits into a PairsChannelSink.
+ *
+ * producer(sink) runs in a separate thread, at most max_blocks blocks of
+ * block_size pairs ahead of the consumer, so only those are in memory at
+ * once. Its exceptions are rethrown to the consumer. Destroying the generator
+ * early stops the producer (at its next full block) and waits for it. The
+ * producer's logging is muted, the consumer may log meanwhile.
+ */
+template <typename T1, typename T2, typename Producer>
+Generator<std::pair<T1, T2>> pairs_generator(
+        Producer producer,
+        u64 block_size = u64(1) << 16,
+        u32 max_blocks = 4) {
+    using Sink = PairsChannelSink<T1, T2>;
+    typename Sink::Channel channel(max_blocks);
+    std::thread thread([&channel, &producer, block_size] {
+        Logger::ThreadMute mute;
+        try {
+            Sink sink(channel, block_size);
+            producer(sink);
+            sink.flush();
+            channel.finish(nullptr);
+        } catch (...) {
+            channel.finish(std::current_exception());
+        }
+    });
+    struct Joiner {
+        typename Sink::Channel &channel;
+        std::thread &thread;
+        ~Joiner() {
+            channel.cancel();
+            thread.join();
+        }
+    } joiner { channel, thread };
+
+    std::vector<std::pair<T1, T2>> block;
+    while (channel.pop(block))
+        for (const auto &p : block)
+            co_yield p;
+}
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_PAIRS_GENERATOR_H__ */
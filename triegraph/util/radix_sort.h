@@ -0,0 +1,121 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __RADIX_SORT_H__
+#define __RADIX_SORT_H__
+
+#include "triegraph/util/thread_pool.h"
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Stable LSD radix sort of elems by key(elem), looking only at the lowest
+ * key_bits bits of the key. Sorting by a minor key first, and then by a major
+ * one gives the lexicographic order.
+ */
+template <typename T, typename Key>
+void radix_sort(std::vector<T> &elems, Key &&key, u32 key_bits) {
+    static constexpr u32 DIGIT_BITS = 8;
+    static constexpr u64 NUM_BUCKETS = u64(1) << DIGIT_BITS;
+
+    std::vector<T> tmp(elems.size());
+    std::array<u64, NUM_BUCKETS + 1> cnt;
+    for (u32 shift = 0; shift < key_bits; shift += DIGIT_BITS) {
+        auto digit = [&](const T &elem) {
+            return (u64(key(elem)) >> shift) & (NUM_BUCKETS - 1);
+        };
+        cnt.fill(0);
+        for (const auto &elem : elems)
+            ++cnt[digit(elem) + 1];
+        for (u64 i = 1; i <= NUM_BUCKETS; ++i)
+            cnt[i] += cnt[i-1];
+        for (auto &elem : elems)
+            tmp[cnt[digit(elem)]++] = std::move(elem);
+        elems.swap(tmp);
+    }
+}
+
+/**
+ * Stable LSD radix sort of two columns together, by the keys column (any
+ * vector-like containers with a size constructor). Every
+ * pass counts digits with per-thread histograms (each thread owns a
+ * contiguous chunk), and then scatters its chunk to the offsets computed
+ * from them, so equal keys keep their order. Only as many passes as the bit
+ * width of the biggest key are made, and passes where all keys have the same
+ * digit are skipped.
+ */
+template <typename KV, typename OV>
+void radix_sort_columns(KV &keys, OV &other, u32 num_threads = 0) {
+    using K = KV::value_type;
+    static_assert(std::is_unsigned_v<K>);
+    static constexpr u32 DIGIT_BITS = 11;
+    static constexpr u64 NUM_BUCKETS = u64(1) << DIGIT_BITS;
+    static constexpr u64 MIN_CHUNK = u64(1) << 14;
+    using Hist = std::array<u64, NUM_BUCKETS>;
+
+    u64 n = keys.size();
+    if (n < 2)
+        return;
+    u32 key_bits = std::bit_width(u64(*std::ranges::max_element(keys)));
+    if (num_threads == 0)
+        num_threads = ThreadPool::default_num_threads();
+    num_threads = u32(std::clamp(n / MIN_CHUNK, u64(1), u64(num_threads)));
+
+    ThreadPool pool(num_threads);
+    auto chunk_beg = [n, num_threads](u32 tid) { return n * tid / num_threads; };
+    std::vector<Hist> hist(num_threads);
+    KV tmp_keys(n);
+    OV tmp_other(n);
+
+    for (u32 shift = 0; shift < key_bits; shift += DIGIT_BITS) {
+        auto digit = [shift](K key) {
+            return (u64(key) >> shift) & (NUM_BUCKETS - 1);
+        };
+        pool.run([&](u32 tid) {
+            auto &h = hist[tid];
+            h.fill(0);
+            for (u64 i = chunk_beg(tid), end = chunk_beg(tid + 1); i < end; ++i)
+                ++h[digit(keys[i])];
+        });
+
+        bool single = false;
+        u64 pos = 0;
+        for (u64 b = 0; b < NUM_BUCKETS; ++b) {
+            u64 total = 0;
+            for (u32 tid = 0; tid < num_threads; ++tid) {
+                auto cnt = hist[tid][b];
+                hist[tid][b] = pos;
+                pos += cnt;
+                total += cnt;
+            }
+            single |= total == n;
+        }
+        if (single)
+            continue;
+
+        pool.run([&](u32 tid) {
+            auto &h = hist[tid];
+            for (u64 i = chunk_beg(tid), end = chunk_beg(tid + 1); i < end; ++i) {
+                auto dst = h[digit(keys[i])]++;
+                tmp_keys[dst] = keys[i];
+                tmp_other[dst] = std::move(other[i]);
+            }
+        });
+        keys.swap(tmp_keys);
+        other.swap(tmp_other);
+    }
+}
+
+} /* namespace triegraph */
+
+#endif /* __RADIX_SORT_H__ */
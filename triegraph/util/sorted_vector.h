@@ -6,13 +6,22 @@
 #ifndef __SORTED_VECTOR_H__
 #define __SORTED_VECTOR_H__
 
+#include "triegraph/util/binary_io.h"
 #include "triegraph/util/util.h"
+#include <algorithm>
 #include <vector>
 #include <unordered_map>
 
 namespace triegraph {
 
-template <typename Beacon, typename Diff = u8>
+/**
+ * Increasing sequence, stored as a beacon (full value) every beacon_interval
+ * elements, and Diff-sized differences between consecutive elements, the
+ * ones that don't fit are in an overflow map. Beacons and diffs are in
+ * Storage (std::vector or VmVector).
+ */
+template <typename Beacon, typename Diff = u8,
+         template <typename> typename Storage = std::vector>
 struct SortedVector {
     using value_type = Beacon;
 
@@ -78,6 +87,47 @@ struct SortedVector {
         return operator[](idx);
     }
 
+    void save(BinaryWriter &w) const {
+        w.write_pod(beacon_interval);
+        w.write_pod(bits_per_diff);
+        w.write_pod(sum);
+        binary_save(w, beacons);
+        binary_save(w, diffs);
+        // sorted, so the file doesn't depend on the hash table
+        std::vector<Beacon> of_keys, of_vals;
+        of_keys.reserve(of_diffs.size());
+        for (const auto &kv : of_diffs)
+            of_keys.push_back(kv.first);
+        std::ranges::sort(of_keys);
+        of_vals.reserve(of_keys.size());
+        for (auto k : of_keys)
+            of_vals.push_back(of_diffs.find(k)->second);
+        binary_save(w, of_keys);
+        binary_save(w, of_vals);
+    }
+
+    void load(BinaryReader &r) {
+        beacon_interval = r.read_pod<u32>();
+        bits_per_diff = r.read_pod<u32>();
+        sum = r.read_pod<Beacon>();
+        if (beacon_interval == 0 || bits_per_diff == 0 ||
+                bits_per_diff > sizeof(Diff) * BITS_PER_BYTE)
+            throw "sorted-vector-load-bad-settings";
+        diff_sentinel = pow(2, bits_per_diff) - 1;
+        binary_load(r, beacons);
+        binary_load(r, diffs);
+        std::vector<Beacon> of_keys, of_vals;
+        binary_load(r, of_keys);
+        binary_load(r, of_vals);
+        if (beacons.size() != div_up(diffs.size(), beacon_interval) ||
+                of_keys.size() != of_vals.size())
+            throw "sorted-vector-load-bad-size";
+        of_diffs.clear();
+        of_diffs.reserve(of_keys.size());
+        for (u64 i = 0; i < of_keys.size(); ++i)
+            of_diffs.emplace(of_keys[i], of_vals[i]);
+    }
+
     // void sanity_check() {
     //     assert(input.size() == size());
     //     for (u64 i = 0; i < size(); ++i) {
@@ -227,8 +277,8 @@ private:
     u32 beacon_interval;
     u32 bits_per_diff;
 
-    std::vector<Beacon> beacons;
-    std::vector<Diff> diffs;
+    Storage<Beacon> beacons;
+    Storage<Diff> diffs;
     std::unordered_map<Beacon, Beacon> of_diffs;
 
     // std::vector<Beacon> input;
@@ -270,11 +320,38 @@ SortedVector sorted_vector_from_elem_seq(std::ranges::sized_range auto &&range)
     return res;
 }
 
+/**
+ * Incremental version of sorted_vector_from_elem_seq, for sorted sequences
+ * that can only be traversed once. push() the elements in order, then take()
+ * the starts.
+ */
+template <typename SortedVector>
+struct SortedStartsBuilder {
+    using value_type = SortedVector::value_type;
+
+    SortedStartsBuilder() { res.push_back(0); }
+
+    void push(value_type elem) {
+        while (id < elem) {
+            ++id;
+            res.push_back(pos);
+        }
+        ++pos;
+    }
+
+    SortedVector take() { return std::move(res); }
+
+private:
+    SortedVector res;
+    value_type id = 0;
+    value_type pos = 0;
+};
+
 template <typename T>
 inline constexpr bool is_sorted_vector_v = false;
 
-template <typename Beacon, typename Diff>
-inline constexpr bool is_sorted_vector_v<SortedVector<Beacon, Diff>> = true;
+template <typename Beacon, typename Diff, template <typename> typename Storage>
+inline constexpr bool is_sorted_vector_v<SortedVector<Beacon, Diff, Storage>> = true;
 
 } /* namespace triegraph */
 
@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_STRIPED_LOCK_H__
+#define __UTIL_STRIPED_LOCK_H__
+
+#include "triegraph/util/util.h"
+
+#include <memory>
+#include <mutex>
+
+namespace triegraph {
+
+/**
+ * A fixed number of mutexes, shared by an arbitrary number of keys. Used to
+ * guard per-node/per-location data without paying for a mutex per key.
+ * Consecutive keys map to different stripes.
+ */
+struct StripedLock {
+    explicit StripedLock(u32 stripes_log2 = 10)
+        : mask((u64(1) << stripes_log2) - 1),
+          stripes(std::make_unique<std::mutex[]>(mask + 1))
+    {}
+
+    std::mutex &stripe(u64 key) { return stripes[key & mask]; }
+    std::unique_lock<std::mutex> lock(u64 key) {
+        return std::unique_lock<std::mutex>(stripe(key));
+    }
+
+private:
+    u64 mask;
+    std::unique_ptr<std::mutex[]> stripes;
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_STRIPED_LOCK_H__ */
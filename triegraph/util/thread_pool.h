@@ -0,0 +1,161 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_THREAD_POOL_H__
+#define __UTIL_THREAD_POOL_H__
+
+#include "triegraph/util/util.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace triegraph {
+
+/**
+ * Fixed-size pool of worker threads. The calling thread participates as
+ * thread 0, so a pool of size 1 spawns nothing and runs everything inline.
+ *
+ * Jobs are fork-join: run() returns only after every thread is done. If a job
+ * throws (on any thread), the first exception is rethrown from run(), after
+ * all threads are done.
+ */
+struct ThreadPool {
+    using Job = std::function<void(u32 /* tid */)>;
+
+    explicit ThreadPool(u32 num_threads = 0)
+        : num_threads(num_threads ? num_threads : default_num_threads()),
+          generation(0),
+          pending(0),
+          stopping(false)
+    {
+        workers.reserve(this->num_threads - 1);
+        for (u32 tid = 1; tid < this->num_threads; ++tid)
+            workers.emplace_back(&ThreadPool::_worker, this, tid);
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            stopping = true;
+        }
+        job_cv.notify_all();
+        for (auto &w : workers)
+            w.join();
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool(ThreadPool &&) = delete;
+    ThreadPool &operator= (const ThreadPool &) = delete;
+    ThreadPool &operator= (ThreadPool &&) = delete;
+
+    static u32 default_num_threads() {
+        return std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    u32 size() const { return num_threads; }
+
+    /** run job(tid) once on every thread, wait for all to finish */
+    void run(Job job) {
+        if (num_threads == 1) {
+            job(0);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lk(mtx);
+            this->job = std::move(job);
+            pending = num_threads - 1;
+            ++ generation;
+        }
+        job_cv.notify_all();
+        _run_job(0);
+        std::unique_lock<std::mutex> lk(mtx);
+        done_cv.wait(lk, [this] { return pending == 0; });
+        this->job = nullptr;
+        if (exc)
+            std::rethrow_exception(std::exchange(exc, nullptr));
+    }
+
+    /**
+     * Split [0, n) in chunks of (at most) grain elements, and hand them out
+     * dynamically. fn(tid, beg, end) is called for every chunk.
+     */
+    template <typename F>
+    void parallel_for(u64 n, u64 grain, F &&fn) {
+        if (n == 0)
+            return;
+        grain = std::max(grain, u64(1));
+        if (num_threads == 1 || n <= grain) {
+            fn(u32(0), u64(0), n);
+            return;
+        }
+        std::atomic<u64> cursor(0);
+        run([&](u32 tid) {
+            while (true) {
+                u64 beg = cursor.fetch_add(grain, std::memory_order_relaxed);
+                if (beg >= n)
+                    break;
+                try {
+                    fn(tid, beg, std::min(n, beg + grain));
+                } catch (...) {
+                    // no more chunks for anybody
+                    cursor.store(n, std::memory_order_relaxed);
+                    throw;
+                }
+            }
+        });
+    }
+
+private:
+    // run job, keeping the first exception for run() to rethrow
+    void _run_job(u32 tid) {
+        try {
+            job(tid);
+        } catch (...) {
+            std::lock_guard<std::mutex> lk(mtx);
+            if (!exc)
+                exc = std::current_exception();
+        }
+    }
+
+    void _worker(u32 tid) {
+        u64 seen = 0;
+        while (true) {
+            std::unique_lock<std::mutex> lk(mtx);
+            job_cv.wait(lk, [this, seen] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            lk.unlock();
+
+            _run_job(tid);
+
+            lk.lock();
+            if (--pending == 0)
+                done_cv.notify_one();
+        }
+    }
+
+    u32 num_threads;
+    std::vector<std::thread> workers;
+
+    std::mutex mtx;
+    std::condition_variable job_cv;
+    std::condition_variable done_cv;
+    Job job;
+    u64 generation;
+    u32 pending;
+    bool stopping;
+    std::exception_ptr exc;
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_THREAD_POOL_H__ */
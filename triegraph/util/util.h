@@ -54,6 +54,15 @@ constexpr u64 div_up(u64 a, u64 b) {
     return (a + b - 1) / b;
 }
 
+// murmur3 finalizer, every input bit affects every output bit
+constexpr u64 mix64(u64 x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    return x ^ (x >> 33);
+}
+
 template <typename T>
 struct quot_rem {
     T quot;
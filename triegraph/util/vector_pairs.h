@@ -6,12 +6,32 @@
 #ifndef __UTIL_VECTOR_PAIRS_H__
 #define __UTIL_VECTOR_PAIRS_H__
 
+#include "triegraph/util/compact_vector.h"
+#include "triegraph/util/radix_sort.h"
 #include "triegraph/util/util.h"
+#include <algorithm>
 #include <functional>
+#include <ranges>
+#include <tuple>
+#include <type_traits>
+#include <vector>
 
 namespace triegraph {
 
-enum struct VectorPairsImpl : u32 { EMPTY = 0, SIMPLE = 1, DUAL = 2 };
+enum struct VectorPairsImpl : u32 { EMPTY = 0, SIMPLE = 1, DUAL = 2, EXTERNAL = 3 };
+
+/**
+ * What is known about the order of the pairs. REV_GROUPED means pairs are
+ * ordered by second, but pairs with equal second could be in any order.
+ *
+ * Producers set it with set_order(), after they are done adding. Adding a
+ * pair resets it to NONE.
+ */
+enum struct VectorPairsOrder : u32 { NONE = 0, FWD = 1, REV = 2, REV_GROUPED = 3 };
+
+/** sinks that builders may fill from several threads at once */
+template <typename Sink>
+inline constexpr bool concurrent_pairs_sink_v = requires { requires Sink::concurrent; };
 
 template <typename T1_, typename T2_, VectorPairsImpl impl_choice>
 struct VectorPairsBase {
@@ -41,6 +61,8 @@ struct VectorPairsEmpty : public VectorPairsBase<T1, T2, VectorPairsImpl::EMPTY>
     Self &sort_by_fwd() { return *this; }
     Self &sort_by_rev() { return *this; }
     Self &unique() { return *this; }
+    void set_order(VectorPairsOrder) {}
+    VectorPairsOrder get_order() const { return VectorPairsOrder::NONE; }
 
     // void write_to_disk() {}
     // // FSStreamer stream_from_disk() {}
@@ -71,6 +93,7 @@ struct VectorPairsSimple : public VectorPairsBase<T1, T2, VectorPairsImpl::SIMPL
     using Self = VectorPairsSimple;
     using Base = VectorPairsBase<T1, T2, VectorPairsImpl::SIMPLE>;
     Base::fwd_vec vec;
+    VectorPairsOrder order = VectorPairsOrder::NONE;
 
     size_t size() const { return vec.size(); }
     void reserve(size_t cap) { vec.reserve(cap); }
@@ -78,19 +101,44 @@ struct VectorPairsSimple : public VectorPairsBase<T1, T2, VectorPairsImpl::SIMPL
     template <typename Tx1, typename Tx2>
     void emplace_back(Tx1 &&a, Tx2 &&b) {
         vec.emplace_back(std::forward<Tx1>(a), std::forward<Tx2>(b));
+        order = VectorPairsOrder::NONE;
+    }
+    void push_back(const Base::fwd_pair &p) {
+        vec.push_back(p);
+        order = VectorPairsOrder::NONE;
     }
-    void push_back(const Base::fwd_pair &p) { vec.push_back(p); }
-    void push_back(Base::fwd_pair &&p) { vec.push_back(std::move(p)); }
+    void push_back(Base::fwd_pair &&p) {
+        vec.push_back(std::move(p));
+        order = VectorPairsOrder::NONE;
+    }
+
+    void set_order(VectorPairsOrder o) { order = o; }
+    VectorPairsOrder get_order() const { return order; }
 
     Self &sort_by_fwd() {
-        std::ranges::sort(vec);
+        if (order != VectorPairsOrder::FWD)
+            std::ranges::sort(vec);
+        order = VectorPairsOrder::FWD;
         return *this;
     }
 
     Self &sort_by_rev() {
-        std::ranges::sort(vec, [](const auto &a, const auto &b) {
+        auto cmp = [](const auto &a, const auto &b) {
             return a.second != b.second ? a.second < b.second : a.first < b.first;
-        });
+        };
+        if (order == VectorPairsOrder::REV_GROUPED) {
+            // only sort within groups of equal second
+            for (auto beg = vec.begin(); beg != vec.end(); ) {
+                auto end = std::find_if(beg + 1, vec.end(), [&](const auto &p) {
+                        return p.second != beg->second; });
+                if (end - beg > 1)
+                    std::sort(beg, end, cmp);
+                beg = end;
+            }
+        } else if (order != VectorPairsOrder::REV) {
+            std::ranges::sort(vec, cmp);
+        }
+        order = VectorPairsOrder::REV;
         return *this;
     }
 
@@ -211,8 +259,8 @@ namespace impl {
         using value_type = std::conditional_t<is_const,
               std::pair<T1, T2>, Pair<T1, T2>>;
         using reference = std::conditional_t<is_const,
-              std::pair<T1, T2>, RefPair<T1, T2, typename v1_iter::reference,
-                                                 typename v2_iter::reference>>;
+              std::pair<T1, T2>, RefPair<T1, T2, std::iter_reference_t<v1_iter>,
+                                                 std::iter_reference_t<v2_iter>>>;
 
         reference operator* () const { return reference(*it1(), *it2()); }
         Self &operator++ () { ++it1_; return *this; }
@@ -242,9 +290,52 @@ template <typename T1, typename T2,
 struct VectorPairsDual : public VectorPairsBase<T1, T2, VectorPairsImpl::DUAL> {
     using Self = VectorPairsDual;
     using Base = VectorPairsBase<T1, T2, VectorPairsImpl::DUAL>;
+    using Column1 = V1;
+    using Column2 = V2;
+
+    /**
+     * Pairs of unsigned integers in plain vectors are sorted with a parallel
+     * radix sort (both columns permuted together), the rest with std::sort
+     * over PairIter.
+     */
+    struct Settings {
+        static constexpr u64 default_radix_min_size = u64(1) << 16;
+        static constexpr u64 default_compact_sort_block = u64(1) << 22;
+        /** threads for the radix sort, 0 -- all cores */
+        u32 sort_threads = 0;
+        /** smaller inputs are sorted with std::sort */
+        u64 radix_min_size = default_radix_min_size;
+        /** CompactVector columns are sorted in blocks of this many pairs */
+        u64 compact_sort_block = default_compact_sort_block;
+
+        static Settings from_config(const auto &cfg) {
+            return {
+                .sort_threads = cfg.template get_or<u32>(
+                        "vector-pairs-sort-threads", 0u),
+                .radix_min_size = cfg.template get_or<u64>(
+                        "vector-pairs-radix-min-size", default_radix_min_size),
+                .compact_sort_block = cfg.template get_or<u64>(
+                        "vector-pairs-compact-sort-block",
+                        default_compact_sort_block),
+            };
+        }
+    };
+
+    // global, like VectorPairsExternal's
+    static Settings &default_settings() {
+        static Settings settings;
+        return settings;
+    }
+    static void set_default_settings(Settings s) { default_settings() = std::move(s); }
+
+    // sorted unpacked, see _sort
+    static constexpr bool compact_columns =
+        is_compact_vector_v<V1> && is_compact_vector_v<V2>;
 
     V1 vec1;
     V2 vec2;
+    VectorPairsOrder order = VectorPairsOrder::NONE;
+    Settings settings = default_settings();
 
     size_t size() const { return vec1.size(); }
     void reserve(size_t cap) { vec1.reserve(cap); vec2.reserve(cap); }
@@ -253,28 +344,48 @@ struct VectorPairsDual : public VectorPairsBase<T1, T2, VectorPairsImpl::DUAL> {
     void emplace_back(Tx1 &&a, Tx2 &&b) {
         vec1.emplace_back(std::forward<Tx1>(a));
         vec2.emplace_back(std::forward<Tx2>(b));
+        order = VectorPairsOrder::NONE;
     }
     void push_back(const impl::Pair<T1, T2> &p) {
         vec1.push_back(p.first);
         vec2.push_back(p.second);
+        order = VectorPairsOrder::NONE;
     }
     void push_back(const std::pair<T1, T2> &p) {
         vec1.push_back(p.first);
         vec2.push_back(p.second);
+        order = VectorPairsOrder::NONE;
     }
 
+    // get_v1/get_v2 give direct access, callers modifying the vectors
+    // through them should reset the order
+    void set_order(VectorPairsOrder o) { order = o; }
+    VectorPairsOrder get_order() const { return order; }
+
     Self &sort_by_fwd() {
-        using PI = impl::PairIter<T1, T2, false, typename V1::iterator, typename V2::iterator>;
-        std::sort(
-                PI(vec1.begin(), vec2.begin(), vec1.begin()),
-                PI(vec1.begin(), vec2.begin(), vec1.end()));
+        if (order != VectorPairsOrder::FWD)
+            _sort(vec1, vec2);
+        order = VectorPairsOrder::FWD;
         return *this;
     }
     Self &sort_by_rev() {
         using PI = impl::PairIter<T2, T1, false, typename V2::iterator, typename V1::iterator>;
-        std::sort(
-                PI(vec2.begin(), vec1.begin(), vec2.begin()),
-                PI(vec2.begin(), vec1.begin(), vec2.end()));
+        auto beg = PI(vec2.begin(), vec1.begin(), vec2.begin());
+        if (order == VectorPairsOrder::REV_GROUPED) {
+            // only sort within groups of equal second
+            for (size_t i = 0, n = vec2.size(); i < n; ) {
+                size_t j = i + 1;
+                T2 key = vec2[i];
+                while (j < n && vec2[j] == key)
+                    ++j;
+                if (j - i > 1)
+                    std::sort(beg + i, beg + j);
+                i = j;
+            }
+        } else if (order != VectorPairsOrder::REV) {
+            _sort(vec2, vec1);
+        }
+        order = VectorPairsOrder::REV;
         return *this;
     }
     Self &unique() {
@@ -306,6 +417,120 @@ struct VectorPairsDual : public VectorPairsBase<T1, T2, VectorPairsImpl::DUAL> {
     V2 &get_v2() { return vec2; }
     V1 take_v1() { V1 res; using std::swap; swap(res, vec1); return res; }
     V2 take_v2() { V2 res; using std::swap; swap(res, vec2); return res; }
+
+private:
+    // sort by (major, minor)
+    template <typename VM, typename Vm>
+    void _sort(VM &major, Vm &minor) {
+        if constexpr (compact_columns)
+            _sort_compact(major, minor);
+        else
+            _sort_columns(major, minor);
+    }
+
+    // Swapping through Ref proxies costs a read-modify-write of two words
+    // per element, so blocks of compact_sort_block pairs are unpacked,
+    // sorted full width and packed back in place, then the sorted blocks are
+    // merged into new packed columns. The peak is twice the packed columns,
+    // plus a few full width blocks (and the radix sort's copy of one).
+    template <typename VM, typename Vm>
+    void _sort_compact(VM &major, Vm &minor) {
+        using TM = VM::value_type;
+        using Tm = Vm::value_type;
+        u64 n = major.size();
+        u64 block = std::max(settings.compact_sort_block, u64(1));
+        {
+            std::vector<TM> maj;
+            std::vector<Tm> min;
+            for (u64 beg = 0; beg < n; beg += block) {
+                u64 len = std::min(block, n - beg);
+                maj.resize(len);
+                min.resize(len);
+                major.unpack(beg, beg + len, maj.data());
+                minor.unpack(beg, beg + len, min.data());
+                _sort_columns(maj, min);
+                major.pack_at(beg, maj.data(), len);
+                minor.pack_at(beg, min.data(), len);
+            }
+        }
+        if (n <= block)
+            return;
+
+        struct Head {
+            TM maj;
+            Tm min;
+            u64 pos;
+            u64 end;
+        };
+        // min-heap over the blocks' current pairs
+        auto after = [](const Head &a, const Head &b) {
+            return std::tie(a.maj, a.min) > std::tie(b.maj, b.min);
+        };
+        const VM &cmaj = major;
+        const Vm &cmin = minor;
+        std::vector<Head> heads;
+        for (u64 beg = 0; beg < n; beg += block)
+            heads.push_back({ cmaj[beg], cmin[beg], beg, std::min(n, beg + block) });
+        std::ranges::make_heap(heads, after);
+
+        VM out_maj;
+        Vm out_min;
+        out_maj.set_bits(compact_vector_get_bits(major)).resize(n);
+        out_min.set_bits(compact_vector_get_bits(minor)).resize(n);
+        out_maj.auto_widen = major.auto_widen;
+        out_min.auto_widen = minor.auto_widen;
+        std::vector<TM> buf_maj;
+        std::vector<Tm> buf_min;
+        static constexpr u64 BUF = u64(1) << 16;
+        buf_maj.reserve(BUF);
+        buf_min.reserve(BUF);
+        u64 written = 0;
+        auto flush = [&] {
+            out_maj.pack_at(written, buf_maj.data(), buf_maj.size());
+            out_min.pack_at(written, buf_min.data(), buf_min.size());
+            written += buf_maj.size();
+            buf_maj.clear();
+            buf_min.clear();
+        };
+        while (!heads.empty()) {
+            std::ranges::pop_heap(heads, after);
+            Head &h = heads.back();
+            buf_maj.push_back(h.maj);
+            buf_min.push_back(h.min);
+            if (++h.pos < h.end) {
+                h.maj = cmaj[h.pos];
+                h.min = cmin[h.pos];
+                std::ranges::push_heap(heads, after);
+            } else {
+                heads.pop_back();
+            }
+            if (buf_maj.size() == BUF)
+                flush();
+        }
+        flush();
+        major = std::move(out_maj);
+        minor = std::move(out_min);
+    }
+
+    template <typename VM, typename Vm>
+    void _sort_columns(VM &major, Vm &minor) {
+        using TM = VM::value_type;
+        using Tm = Vm::value_type;
+        if constexpr (std::is_unsigned_v<TM> && std::is_unsigned_v<Tm> &&
+                std::ranges::contiguous_range<VM> &&
+                std::ranges::contiguous_range<Vm>) {
+            if (major.size() >= settings.radix_min_size) {
+                radix_sort_columns(minor, major, settings.sort_threads);
+                radix_sort_columns(major, minor, settings.sort_threads);
+                return;
+            }
+        }
+        using PI = impl::PairIter<TM, Tm, false,
+              typename VM::iterator, typename Vm::iterator>;
+        std::sort(
+                PI(major.begin(), minor.begin(), major.begin()),
+                PI(major.begin(), minor.begin(), major.end()));
+    }
 };
 
 } /* namespace triegraph */
@@ -0,0 +1,434 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_VECTOR_PAIRS_EXTERNAL_H__
+#define __UTIL_VECTOR_PAIRS_EXTERNAL_H__
+
+#include "triegraph/util/logger.h"
+#include "triegraph/util/util.h"
+#include "triegraph/util/vector_pairs.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <filesystem>
+#include <iterator>
+#include <memory>
+#include <queue>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <unistd.h>
+
+namespace triegraph {
+
+/**
+ * VectorPairs that don't have to fit in memory.
+ *
+ * Pairs are buffered up to a memory budget. When the buffer is full, it is
+ * sorted and written to a temporary file (a run). The sorted sequence is
+ * never materialized: fwd_pairs()/rev_pairs() return a single-pass input
+ * range, doing a k-way merge of the runs (and the in-memory buffer).
+ *
+ * Runs are sorted in one order at a time. Sorting in the other order
+ * streams the merge through a fresh buffer, forming new runs.
+ *
+ * A merge opens a file per run, so when max_runs runs pile up, they are first
+ * merged into one (file to file).
+ *
+ * unique() re-forms spilled runs without duplicates (in the same order), so
+ * size() stays exact, at the cost of a pass over the runs.
+ */
+template <typename T1, typename T2>
+struct VectorPairsExternal : public VectorPairsBase<T1, T2, VectorPairsImpl::EXTERNAL> {
+    using Self = VectorPairsExternal;
+    using Base = VectorPairsBase<T1, T2, VectorPairsImpl::EXTERNAL>;
+
+    struct Settings {
+        static constexpr u64 default_mem_budget = u64(1) << 30;
+        static constexpr u32 default_max_runs = 64;
+        /** bytes of pairs kept in memory, before spilling a run to disk */
+        u64 mem_budget = default_mem_budget;
+        /** where runs are stored, the system temp dir if empty */
+        std::string tmp_dir = "";
+        /** most runs (open files) merged at once, at least 2 */
+        u32 max_runs = default_max_runs;
+
+        static Settings from_config(const auto &cfg) {
+            return {
+                .mem_budget = cfg.template get_or<u64>(
+                        "vector-pairs-mem-budget", default_mem_budget),
+                .tmp_dir = cfg.template get_or<std::string>(
+                        "vector-pairs-tmp-dir", ""),
+                .max_runs = cfg.template get_or<u32>(
+                        "vector-pairs-max-runs", default_max_runs),
+            };
+        }
+    };
+
+    // Like Kmer settings, these are global, because pairs are default
+    // constructed deep inside the Manager.
+    static Settings &default_settings() {
+        static Settings settings;
+        return settings;
+    }
+    static void set_default_settings(Settings s) { default_settings() = std::move(s); }
+
+    VectorPairsExternal(Settings s = default_settings())
+        : settings(std::move(s)),
+          buf_cap(std::max(u64(1), settings.mem_budget / sizeof(Rec)))
+    {}
+
+    VectorPairsExternal(const Self &) = delete;
+    VectorPairsExternal(Self &&) = default;
+    Self &operator= (const Self &) = delete;
+    Self &operator= (Self &&) = default;
+
+    size_t size() const { return num_pairs; }
+    void reserve(size_t) {}
+    u64 num_runs() const { return runs.size(); }
+
+    template <typename Tx1, typename Tx2>
+    void emplace_back(Tx1 &&a, Tx2 &&b) {
+        buf.push_back({ T1(std::forward<Tx1>(a)), T2(std::forward<Tx2>(b)) });
+        ++num_pairs;
+        is_unique = false;
+        if (buf.size() >= buf_cap)
+            _spill();
+    }
+    void push_back(const std::pair<T1, T2> &p) { emplace_back(p.first, p.second); }
+
+    void set_order(VectorPairsOrder) {}
+    VectorPairsOrder get_order() const { return VectorPairsOrder::NONE; }
+
+    Self &sort_by_fwd() { _reorder(VectorPairsOrder::FWD); return *this; }
+    Self &sort_by_rev() { _reorder(VectorPairsOrder::REV); return *this; }
+    Self &unique() {
+        if (is_unique)
+            return *this;
+        is_unique = true;
+        if (runs.empty())
+            _unique_buf();
+        else
+            _reform(order);
+        return *this;
+    }
+
+    struct FwdProj {
+        using value_type = std::pair<T1, T2>;
+        value_type operator() (const auto &r) const { return { r.first, r.second }; }
+    };
+    struct RevProj {
+        using value_type = std::pair<T2, T1>;
+        value_type operator() (const auto &r) const { return { r.second, r.first }; }
+    };
+
+    /**
+     * Single-pass range over all pairs, in the order of the last sort. Pairs
+     * added after that come in arbitrary order.
+     */
+    template <typename Proj>
+    struct MergeRange;
+    MergeRange<FwdProj> fwd_pairs() const { return { *this }; }
+    MergeRange<RevProj> rev_pairs() const { return { *this }; }
+
+private:
+    struct Rec {
+        T1 first;
+        T2 second;
+    };
+    static_assert(std::is_trivially_copyable_v<Rec>);
+
+    static bool _less(const Rec &a, const Rec &b, VectorPairsOrder order) {
+        if (order == VectorPairsOrder::REV)
+            return a.second != b.second ? a.second < b.second : a.first < b.first;
+        return a.first != b.first ? a.first < b.first : a.second < b.second;
+    }
+    static bool _eq(const Rec &a, const Rec &b) {
+        return a.first == b.first && a.second == b.second;
+    }
+
+    /** a sorted run in a temp file, removed on destruction */
+    struct Run {
+        std::string path;
+        u64 size = 0;
+
+        Run() {}
+        Run(std::string path, u64 size) : path(std::move(path)), size(size) {}
+        Run(const Run &) = delete;
+        Run(Run &&other) : path(std::move(other.path)), size(other.size) {
+            other.path.clear();
+        }
+        Run &operator= (const Run &) = delete;
+        Run &operator= (Run &&other) {
+            std::swap(path, other.path);
+            std::swap(size, other.size);
+            return *this;
+        }
+        ~Run() {
+            if (!path.empty())
+                std::remove(path.c_str());
+        }
+    };
+
+    /** buffered sequential reader of a run */
+    struct RunReader {
+        static constexpr u64 CHUNK = 1u << 14;
+
+        std::FILE *f = nullptr;
+        u64 left = 0;
+        std::vector<Rec> chunk;
+        u64 pos = 0;
+
+        RunReader(const Run &run) : left(run.size) {
+            f = std::fopen(run.path.c_str(), "rb");
+            if (!f)
+                throw "vector-pairs-external-open-failed";
+            _fill();
+        }
+        RunReader(const RunReader &) = delete;
+        RunReader(RunReader &&other)
+            : f(std::exchange(other.f, nullptr)),
+              left(other.left),
+              chunk(std::move(other.chunk)),
+              pos(other.pos) {}
+        ~RunReader() { if (f) std::fclose(f); }
+
+        bool done() const { return pos == chunk.size(); }
+        const Rec &top() const { return chunk[pos]; }
+        void next() { if (++pos == chunk.size()) _fill(); }
+
+        void _fill() {
+            u64 n = std::min(left, CHUNK);
+            chunk.resize(n);
+            pos = 0;
+            if (n && std::fread(chunk.data(), sizeof(Rec), n, f) != n)
+                throw "vector-pairs-external-read-failed";
+            left -= n;
+        }
+    };
+
+    /** k-way merge of the runs and the (sorted) in-memory buffer */
+    struct Merger {
+        std::vector<RunReader> readers;
+        const std::vector<Rec> *mem;
+        u64 mem_pos = 0;
+        VectorPairsOrder order;
+        bool unique;
+        // source indices; readers.size() denotes the in-memory buffer
+        std::vector<u32> heap;
+        Rec cur;
+        bool has_cur = false;
+
+        Merger(const Self &vp) : Merger(vp.runs, &vp.buf, vp.order, vp.is_unique) {}
+        Merger(const std::vector<Run> &runs, const std::vector<Rec> *mem,
+                VectorPairsOrder order, bool unique)
+            : mem(mem), order(order), unique(unique) {
+            readers.reserve(runs.size());
+            for (const auto &run : runs)
+                readers.emplace_back(run);
+            for (u32 i = 0; i <= readers.size(); ++i)
+                if (!_done(i))
+                    _heap_push(i);
+            advance();
+        }
+
+        const Rec &_top(u32 i) const {
+            return i < readers.size() ? readers[i].top() : (*mem)[mem_pos];
+        }
+        bool _done(u32 i) const {
+            return i < readers.size() ? readers[i].done() : mem_pos == mem->size();
+        }
+        void _next(u32 i) {
+            if (i < readers.size()) readers[i].next(); else ++mem_pos;
+        }
+
+        // min-heap by the current order
+        bool _heap_cmp(u32 a, u32 b) const { return _less(_top(b), _top(a), order); }
+        void _heap_push(u32 i) {
+            heap.push_back(i);
+            std::push_heap(heap.begin(), heap.end(),
+                    [this](u32 a, u32 b) { return _heap_cmp(a, b); });
+        }
+        u32 _heap_pop() {
+            std::pop_heap(heap.begin(), heap.end(),
+                    [this](u32 a, u32 b) { return _heap_cmp(a, b); });
+            u32 res = heap.back();
+            heap.pop_back();
+            return res;
+        }
+
+        void advance() {
+            while (!heap.empty()) {
+                u32 i = _heap_pop();
+                Rec r = _top(i);
+                _next(i);
+                if (!_done(i))
+                    _heap_push(i);
+                if (unique && has_cur && _eq(cur, r))
+                    continue;
+                cur = r;
+                has_cur = true;
+                return;
+            }
+            has_cur = false;
+        }
+    };
+
+public:
+    template <typename Proj>
+    struct MergeRange {
+        const Self &vp;
+
+        struct Iterator {
+            using value_type = Proj::value_type;
+            using difference_type = std::ptrdiff_t;
+            using iterator_category = std::input_iterator_tag;
+
+            std::shared_ptr<Merger> merger;
+
+            value_type operator* () const { return Proj {}(merger->cur); }
+            Iterator &operator++ () { merger->advance(); return *this; }
+            void operator++ (int) { merger->advance(); }
+            bool operator== (std::default_sentinel_t) const {
+                return !merger->has_cur;
+            }
+        };
+
+        Iterator begin() const { return { std::make_shared<Merger>(vp) }; }
+        std::default_sentinel_t end() const { return {}; }
+    };
+
+private:
+    Settings settings;
+    u64 buf_cap;
+    std::vector<Rec> buf;
+    std::vector<Run> runs;
+    u64 num_pairs = 0;
+    // order of the runs (the buffer is sorted right before use)
+    VectorPairsOrder order = VectorPairsOrder::NONE;
+    bool is_unique = false;
+
+    void _sort_buf(VectorPairsOrder o) {
+        std::sort(buf.begin(), buf.end(), [o](const Rec &a, const Rec &b) {
+            return _less(a, b, o);
+        });
+    }
+
+    std::string _run_path() const {
+        static std::atomic<u64> counter(0);
+        std::filesystem::path dir = settings.tmp_dir.empty()
+            ? std::filesystem::temp_directory_path()
+            : std::filesystem::path(settings.tmp_dir);
+        return dir / ("triegraph-pairs-" + std::to_string(::getpid()) +
+                "-" + std::to_string(counter++) + ".run");
+    }
+
+    void _spill() {
+        if (order == VectorPairsOrder::NONE)
+            order = VectorPairsOrder::REV; // TrieData sorts by rev first
+        _sort_buf(order);
+
+        auto path = _run_path();
+        std::FILE *f = std::fopen(path.c_str(), "wb");
+        if (!f)
+            throw "vector-pairs-external-open-failed";
+        bool ok = std::fwrite(buf.data(), sizeof(Rec), buf.size(), f) == buf.size();
+        ok = std::fclose(f) == 0 && ok;
+        runs.emplace_back(std::move(path), buf.size());
+        if (!ok)
+            throw "vector-pairs-external-write-failed";
+        buf.clear();
+        if (runs.size() >= std::max(settings.max_runs, 2u))
+            _merge_runs();
+    }
+
+    // merge all runs into one, streaming from file to file
+    void _merge_runs() {
+        auto scope = Logger::get().begin_scoped("merging pairs runs");
+        static const std::vector<Rec> no_mem;
+        u64 before = 0;
+        for (const auto &run : runs)
+            before += run.size;
+
+        Run res(_run_path(), 0);
+        std::FILE *f = std::fopen(res.path.c_str(), "wb");
+        if (!f)
+            throw "vector-pairs-external-open-failed";
+        std::vector<Rec> chunk;
+        chunk.reserve(RunReader::CHUNK);
+        bool ok = true;
+        auto flush = [&] {
+            ok = ok && std::fwrite(chunk.data(), sizeof(Rec), chunk.size(), f) == chunk.size();
+            res.size += chunk.size();
+            chunk.clear();
+        };
+        for (auto merger = Merger(runs, &no_mem, order, is_unique);
+                merger.has_cur; merger.advance()) {
+            chunk.push_back(merger.cur);
+            if (chunk.size() == RunReader::CHUNK)
+                flush();
+        }
+        flush();
+        ok = std::fclose(f) == 0 && ok;
+        if (!ok)
+            throw "vector-pairs-external-write-failed";
+        num_pairs -= before - res.size;
+        runs.clear();
+        runs.push_back(std::move(res));
+    }
+
+    void _reorder(VectorPairsOrder o) {
+        if (runs.empty() || order == o) {
+            _sort_buf(o);
+            order = o;
+            if (is_unique && runs.empty())
+                _unique_buf();
+            return;
+        }
+        _reform(o);
+    }
+
+    // stream the merge (skipping duplicates if unique) into new runs, sorted
+    // by o, counting the pairs again
+    void _reform(VectorPairsOrder o) {
+        auto scope = Logger::get().begin_scoped("re-forming pairs runs");
+        // spill the buffer, instead of keeping it next to the new one
+        if (!buf.empty())
+            _spill();
+        std::vector<Rec>().swap(buf);
+        auto old_runs = std::move(runs);
+        runs.clear();
+        bool uniq = is_unique;
+
+        Self old(settings);
+        old.runs = std::move(old_runs);
+        old.order = order;
+        old.is_unique = uniq;
+
+        order = o;
+        num_pairs = 0;
+        for (auto merger = Merger(old); merger.has_cur; merger.advance()) {
+            buf.push_back(merger.cur);
+            ++num_pairs;
+            if (buf.size() >= buf_cap)
+                _spill();
+        }
+        _sort_buf(o);
+        is_unique = uniq;
+    }
+
+    void _unique_buf() {
+        auto end = std::unique(buf.begin(), buf.end(), _eq);
+        num_pairs -= buf.end() - end;
+        buf.erase(end, buf.end());
+    }
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_VECTOR_PAIRS_EXTERNAL_H__ */
@@ -6,6 +6,8 @@
 #ifndef __UTIL_VECTOR_PAIRS_INSERTER_H__
 #define __UTIL_VECTOR_PAIRS_INSERTER_H__
 
+#include "triegraph/util/vector_pairs.h"
+
 namespace triegraph {
 
 template <typename VectorPairs,
@@ -14,6 +16,7 @@ template <typename VectorPairs,
          typename value_type_>
 struct VectorPairsInserter {
     using value_type = value_type_;
+    static constexpr bool concurrent = concurrent_pairs_sink_v<VectorPairs>;
     VectorPairs &pairs;
     FirstMapper fmap;
     SecondMapper smap;
@@ -23,8 +26,16 @@ struct VectorPairsInserter {
           smap(smap)
     {}
 
+    size_t size() const { return pairs.size(); }
     void reserve(size_t capacity) { pairs.reserve(capacity); }
 
+    // only order by second survives the mapping
+    void set_order(VectorPairsOrder o) {
+        pairs.set_order(
+                o == VectorPairsOrder::REV ? VectorPairsOrder::REV_GROUPED :
+                o == VectorPairsOrder::FWD ? VectorPairsOrder::NONE : o);
+    }
+
     void emplace_back(auto &&a, auto &&b) {
         pairs.emplace_back(
                 fmap(std::forward<decltype(a)>(a)),
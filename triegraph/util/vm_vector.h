@@ -0,0 +1,245 @@
+// SPDX-License-Identifier: MPL-2.0
+/*
+ * Copyright (c) 2021, Iskren Chernev
+ */
+
+#ifndef __UTIL_VM_VECTOR_H__
+#define __UTIL_VM_VECTOR_H__
+
+#include "triegraph/util/binary_io.h"
+#include "triegraph/util/util.h"
+
+#include <sys/mman.h> /* mmap, mremap, mprotect, madvise */
+#include <unistd.h> /* sysconf */
+
+#include <algorithm>
+#include <cstring> /* memcpy */
+#include <type_traits>
+#include <utility>
+
+namespace triegraph {
+
+/**
+ * Vector in a reserved range of virtual memory.
+ *
+ * A big address range is reserved up front with mmap(PROT_NONE), and made
+ * accessible as the vector grows, so growing never copies the elements (nor
+ * needs the old and new buffer at the same time, like doubling does). Only
+ * touched pages take physical memory. If the range runs out, it is extended
+ * with mremap, which moves the page mappings, not the data.
+ *
+ * Only for trivially copyable elements, which are never constructed or
+ * destroyed one by one.
+ *
+ * load() maps the saved elements from the file (copy-on-write), instead of
+ * reading them: pages are read on first touch, and shared with the page cache
+ * until written to.
+ */
+template <typename T>
+struct VmVector {
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    using value_type = T;
+    using size_type = u64;
+    using difference_type = std::ptrdiff_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using iterator = T *;
+    using const_iterator = const T *;
+    using Self = VmVector;
+
+    /** address space reserved by each vector, on first growth */
+    static u64 &default_reserve_bytes() {
+        static u64 bytes = u64(1) << 36;
+        return bytes;
+    }
+
+    VmVector() {}
+    explicit VmVector(u64 size) { resize(size); }
+    VmVector(u64 size, const T &val) { resize(size, val); }
+    VmVector(const Self &other) {
+        _ensure(other.sz);
+        if (other.sz)
+            std::memcpy(ptr, other.ptr, other.sz * sizeof(T));
+        sz = other.sz;
+    }
+    VmVector(Self &&other) { swap(other); }
+    Self &operator= (const Self &other) {
+        if (this != &other)
+            Self(other).swap(*this);
+        return *this;
+    }
+    Self &operator= (Self &&other) {
+        Self(std::move(other)).swap(*this);
+        return *this;
+    }
+    ~VmVector() {
+        if (ptr)
+            ::munmap(ptr, reserved);
+    }
+
+    void swap(Self &other) {
+        std::swap(ptr, other.ptr);
+        std::swap(sz, other.sz);
+        std::swap(committed, other.committed);
+        std::swap(reserved, other.reserved);
+        std::swap(mapped, other.mapped);
+    }
+    friend void swap(Self &a, Self &b) { a.swap(b); }
+
+    u64 size() const { return sz; }
+    bool empty() const { return sz == 0; }
+    u64 capacity() const { return committed / sizeof(T); }
+    u64 reserved_bytes() const { return reserved; }
+
+    void reserve(u64 cap) { _ensure(cap); }
+
+    void resize(u64 size) { resize(size, T {}); }
+    void resize(u64 size, const T &val) {
+        if (size > sz) {
+            _ensure(size);
+            std::fill(ptr + sz, ptr + size, val);
+        }
+        sz = size;
+    }
+
+    void push_back(const T &val) {
+        if (sz == capacity())
+            _ensure(sz + 1);
+        ptr[sz++] = val;
+    }
+    template <typename... Args>
+    void emplace_back(Args&&... args) { push_back(T(std::forward<Args>(args)...)); }
+    void pop_back() { --sz; }
+    void clear() { sz = 0; }
+
+    /** return the pages past the end to the OS, keeping the reservation */
+    void shrink_to_fit() {
+        u64 keep = _page_up(sz * sizeof(T));
+        if (keep < committed) {
+            ::madvise(reinterpret_cast<char *>(ptr) + keep, committed - keep,
+                    MADV_DONTNEED);
+            ::mprotect(reinterpret_cast<char *>(ptr) + keep, committed - keep,
+                    PROT_NONE);
+            committed = keep;
+        }
+    }
+
+    void save(BinaryWriter &w) const { w.write_section(ptr, sz); }
+
+    void load(BinaryReader &r) {
+        auto sec = r.read_section<T>();
+        if (sec.offset % _page_up(1) != 0) {
+            // pages bigger than the section alignment, can't map
+            Self res(sec.size);
+            r.read_at(res.ptr, sec.size * sizeof(T), sec.offset);
+            swap(res);
+            return;
+        }
+        map_file(r.fd(), sec.offset, sec.size);
+    }
+
+    /**
+     * Replace the contents with size elements at offset (page aligned) in the
+     * file fd, mapped copy-on-write at the start of a fresh reservation. The
+     * file may be closed afterwards.
+     */
+    void map_file(int fd, u64 offset, u64 size) {
+        Self res;
+        if (size) {
+            u64 bytes = _page_up(size * sizeof(T));
+            res._reserve(std::max(bytes, default_reserve_bytes()));
+            void *m = ::mmap(res.ptr, bytes, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_FIXED, fd, offset);
+            if (m == MAP_FAILED)
+                throw "vm-vector-mmap-failed";
+            res.committed = bytes;
+            res.mapped = true;
+            res.sz = size;
+        }
+        swap(res);
+    }
+
+    T &operator[] (u64 idx) { return ptr[idx]; }
+    const T &operator[] (u64 idx) const { return ptr[idx]; }
+    T &at(u64 idx) { return idx < sz ? ptr[idx] : throw "idx-out-of-range"; }
+    const T &at(u64 idx) const { return idx < sz ? ptr[idx] : throw "idx-out-of-range"; }
+    T &front() { return ptr[0]; }
+    const T &front() const { return ptr[0]; }
+    T &back() { return ptr[sz - 1]; }
+    const T &back() const { return ptr[sz - 1]; }
+    T *data() { return ptr; }
+    const T *data() const { return ptr; }
+
+    iterator begin() { return ptr; }
+    iterator end() { return ptr + sz; }
+    const_iterator begin() const { return ptr; }
+    const_iterator end() const { return ptr + sz; }
+
+private:
+    static u64 _page_up(u64 bytes) {
+        static const u64 page = ::sysconf(_SC_PAGESIZE);
+        return div_up(bytes, page) * page;
+    }
+
+    // reserve (but don't commit) an address range, on an empty vector
+    void _reserve(u64 bytes) {
+        reserved = _page_up(bytes);
+        void *res = ::mmap(nullptr, reserved, PROT_NONE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (res == MAP_FAILED)
+            throw "vm-vector-mmap-failed";
+        ptr = static_cast<T *>(res);
+    }
+
+    // make room for cap elements
+    void _ensure(u64 cap) {
+        u64 need = cap * sizeof(T);
+        if (need <= committed)
+            return;
+        if (ptr == nullptr)
+            _reserve(std::max(need, default_reserve_bytes()));
+        // commit in growing steps, to keep the number of mprotect calls
+        // logarithmic
+        u64 ncommit = std::min(
+                _page_up(std::max({ need, 2 * committed, u64(1) << 16 })),
+                reserved);
+        if (need > reserved && mapped) {
+            // a file mapping followed by anonymous pages can't be mremap-ed
+            // as one range, move to a fresh (anonymous) reservation instead
+            Self res;
+            res._ensure(cap);
+            std::memcpy(res.ptr, ptr, sz * sizeof(T));
+            res.sz = sz;
+            swap(res);
+            return;
+        }
+        if (need > reserved) {
+            // commit everything, so the mapping is a single read-write range,
+            // which mremap can extend
+            if (::mprotect(ptr, reserved, PROT_READ | PROT_WRITE) != 0)
+                throw "vm-vector-mprotect-failed";
+            u64 nreserved = _page_up(std::max(need, 2 * reserved));
+            void *res = ::mremap(ptr, reserved, nreserved, MREMAP_MAYMOVE);
+            if (res == MAP_FAILED)
+                throw "vm-vector-mremap-failed";
+            ptr = static_cast<T *>(res);
+            reserved = committed = nreserved;
+            return;
+        }
+        if (::mprotect(reinterpret_cast<char *>(ptr) + committed,
+                    ncommit - committed, PROT_READ | PROT_WRITE) != 0)
+            throw "vm-vector-mprotect-failed";
+        committed = ncommit;
+    }
+
+    T *ptr = nullptr;
+    u64 sz = 0;
+    u64 committed = 0;
+    u64 reserved = 0;
+    bool mapped = false; // starts with a file mapping (map_file)
+};
+
+} /* namespace triegraph */
+
+#endif /* __UTIL_VM_VECTOR_H__ */